@@ -0,0 +1,257 @@
+// chain.c
+// the one pointer chain builder. every probe is a ptr = *ptr chase over
+// nodes laid out somewhere in the arena, only the node order changes.
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "memprobe.h"
+
+// below this the single-threaded build is already fast enough
+#define CHAIN_MT_MIN_BYTES (256 * MB)
+#define CHAIN_MAX_THREADS 64
+
+// xoshiro256** state. one per build thread, seeded from the global seed
+// through splitmix64 so threads never share a stream.
+typedef struct {
+    uint64_t s[4];
+} rng_t;
+
+static uint64_t chain_seed_value = 1;
+static int chain_threads_value = 1;
+static rng_t misc_rng;
+
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static void rng_init(rng_t *r, uint64_t seed) {
+    for (int i = 0; i < 4; i++) r->s[i] = splitmix64(&seed);
+}
+
+static inline uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t rng_next(rng_t *r) {
+    uint64_t *s = r->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+// uniform-enough value in [0, range) without a divide (Lemire's multiply-shift)
+static inline uint64_t rng_below(rng_t *r, uint64_t range) {
+    return (uint64_t)(((unsigned __int128)rng_next(r) * range) >> 64);
+}
+
+void chain_seed(uint64_t seed) {
+    chain_seed_value = seed;
+    rng_init(&misc_rng, seed ^ 0x5bd1e995ULL);
+}
+
+// random numbers for everything that isn't a chain (point order etc.)
+uint64_t chain_rand(void) {
+    return rng_next(&misc_rng);
+}
+
+// threads used to build chains bigger than CHAIN_MT_MIN_BYTES
+void chain_threads(int threads) {
+    chain_threads_value = threads > 0 ? threads : 1;
+}
+
+// Sattolo's shuffle over the nodes first, first+step, first+2*step, ...
+// every node starts out pointing at itself and the shuffle swaps the
+// pointers around, so the result is one cycle through all count nodes
+// with no index array on the side.
+static void sattolo(char *base, size_t first, size_t step, size_t count,
+                    size_t stride, rng_t *rng) {
+    for (size_t k = 0; k < count; k++) {
+        char *node = base + (first + k * step) * stride;
+        *(void**)node = node;
+    }
+    for (size_t i = count - 1; i > 0; i--) {
+        size_t j = rng_below(rng, i);
+        void **a = (void**)(base + (first + i * step) * stride);
+        void **b = (void**)(base + (first + j * step) * stride);
+        void *temp = *a;
+        *a = *b;
+        *b = temp;
+    }
+}
+
+typedef struct {
+    char *base;
+    size_t first;
+    size_t step;
+    size_t count;
+    size_t stride;
+    uint64_t seed;
+} sattolo_job_t;
+
+static void *sattolo_thread(void *arg) {
+    sattolo_job_t *job = arg;
+    rng_t rng;
+    rng_init(&rng, job->seed);
+    sattolo(job->base, job->first, job->step, job->count, job->stride, &rng);
+    return NULL;
+}
+
+// multi-threaded build: thread t shuffles every node with index == t mod T
+// into its own cycle (so each cycle still spans the whole buffer), then the
+// T cycles get spliced into one by rotating the next pointers of node 0..T-1.
+// falls back to the single-threaded build if threads can't be started.
+static int chain_random_mt(char *base, size_t n, size_t stride, int threads) {
+    pthread_t tids[CHAIN_MAX_THREADS];
+    sattolo_job_t jobs[CHAIN_MAX_THREADS];
+
+    // the caller may be pinned to one core; the build should use them all.
+    // take the real online list, ids aren't contiguous once cpus go offline
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    cpumask_t online;
+    if (online_cpus(&online) == 0) {
+        cpu_set_t all;
+        CPU_ZERO(&all);
+        for (int c = 0; c < MAX_CPUS && c < CPU_SETSIZE; c++) {
+            if (cpumask_test(&online, c)) CPU_SET(c, &all);
+        }
+        pthread_attr_setaffinity_np(&attr, sizeof(all), &all);
+    }
+
+    int started = 0;
+    for (int t = 0; t < threads; t++) {
+        jobs[t] = (sattolo_job_t){
+            .base = base,
+            .first = (size_t)t,
+            .step = (size_t)threads,
+            .count = (n - t + threads - 1) / threads,
+            .stride = stride,
+            .seed = chain_seed_value + 0x1000193ULL * (t + 1),
+        };
+        if (pthread_create(&tids[t], &attr, sattolo_thread, &jobs[t]) != 0) break;
+        started++;
+    }
+    pthread_attr_destroy(&attr);
+    for (int t = 0; t < started; t++) pthread_join(tids[t], NULL);
+    if (started < threads) return -1;
+
+    // splice: node t jumps into cycle t+1 where node t+1 used to go
+    void *first_next = *(void**)base;
+    for (int t = 0; t < threads - 1; t++) {
+        *(void**)(base + t * stride) = *(void**)(base + (t + 1) * stride);
+    }
+    *(void**)(base + (size_t)(threads - 1) * stride) = first_next;
+    return 0;
+}
+
+// link bytes/stride nodes spaced stride apart into one random cycle.
+// random order kills the prefetcher. returns the head, NULL on failure.
+void **chain_random(char *base, size_t bytes, size_t stride) {
+    size_t n = bytes / stride;
+    if (n < 2) return NULL;
+
+    int threads = chain_threads_value;
+    if (threads > CHAIN_MAX_THREADS) threads = CHAIN_MAX_THREADS;
+    if (bytes >= CHAIN_MT_MIN_BYTES && threads > 1 && n >= (size_t)threads * 2) {
+        if (chain_random_mt(base, n, stride, threads) == 0) {
+            chain_seed_value = splitmix64(&chain_seed_value);
+            return (void**)base;
+        }
+    }
+
+    rng_t rng;
+    rng_init(&rng, chain_seed_value);
+    // advance the global seed so back-to-back chains differ
+    chain_seed_value = splitmix64(&chain_seed_value);
+
+    sattolo(base, 0, 1, n, stride, &rng);
+    return (void**)base;
+}
+
+// link count nodes spaced stride apart in address order, last one loops back
+void **chain_strided(char *base, size_t count, size_t stride) {
+    if (count == 0) return NULL;
+    for (size_t i = 0; i < count - 1; i++) {
+        *(void**)(base + i * stride) = base + (i + 1) * stride;
+    }
+    *(void**)(base + (count - 1) * stride) = base;
+    return (void**)base;
+}
+
+// link arbitrary nodes in the order given, last one loops back
+void **chain_list(char **nodes, size_t count) {
+    if (count == 0) return NULL;
+    for (size_t i = 0; i < count - 1; i++) *(void**)nodes[i] = nodes[i + 1];
+    *(void**)nodes[count - 1] = nodes[0];
+    return (void**)nodes[0];
+}
+
+// one node per page, pages visited in a random single cycle, and the node's
+// line inside its page rotates with the page index so consecutive nodes
+// don't all land in the same cache set
+void **chain_pages(char *base, size_t count, size_t page) {
+    if (count < 2) return chain_strided(base, count, page);
+    size_t *next = malloc(count * sizeof(size_t));
+    if (!next) return NULL;
+
+    rng_t rng;
+    rng_init(&rng, chain_seed_value);
+    chain_seed_value = splitmix64(&chain_seed_value);
+
+    for (size_t i = 0; i < count; i++) next[i] = i;
+    for (size_t i = count - 1; i > 0; i--) {
+        size_t j = rng_below(&rng, i);
+        size_t temp = next[i];
+        next[i] = next[j];
+        next[j] = temp;
+    }
+
+    size_t lines = page / CACHE_LINE_SIZE;
+    for (size_t i = 0; i < count; i++) {
+        char *node = base + i * page + (i % lines) * CACHE_LINE_SIZE;
+        char *to = base + next[i] * page + (next[i] % lines) * CACHE_LINE_SIZE;
+        *(void**)node = to;
+    }
+    free(next);
+    return (void**)base;
+}
+
+// noinline so the compiler can't see through the loop and fold it away
+__attribute__((noinline))
+void **chase(void **p, size_t steps) {
+    for (size_t i = 0; i < steps; i++) {
+        p = (void**)*p;
+    }
+    return p;
+}
+
+static void * volatile chase_sink;
+
+// warm up, then time a fixed number of dependent loads. ns per access.
+double chase_ns(void **head, size_t warmup, size_t iterations) {
+    if (!head || iterations == 0) return 0.0;
+
+    void **p = chase(head, warmup);
+
+    counters_begin();
+    uint64_t start = timer_start();
+    p = chase(p, iterations);
+    uint64_t end = timer_stop();
+    counters_end(iterations);
+
+    chase_sink = p;
+    return timer_elapsed_ns(start, end, iterations);
+}
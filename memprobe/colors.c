@@ -0,0 +1,111 @@
+// colors.c
+// page coloring on top of the arena. a cache whose set span (sets * line)
+// is larger than a page takes its upper index bits from the frame number,
+// so pages with the same frame number mod span / PAGE_SIZE (the same
+// "color") land on the same sets. the frame numbers come from pagemap; when
+// the arena sits entirely on huge pages and the span fits inside one,
+// virtual addresses already carry the right bits. pages are handed out per
+// color until that color runs dry, colors_reset() gives them all back.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memprobe.h"
+
+static size_t page_color(const color_map_t *cm, const uint64_t *phys, size_t p) {
+    uint64_t addr = phys ? phys[p] : (uint64_t)(uintptr_t)(cm->base + p * PAGE_SIZE);
+    return (size_t)(addr / PAGE_SIZE % cm->ncolors);
+}
+
+int colors_init(color_map_t *cm, const arena_t *arena, size_t span) {
+    memset(cm, 0, sizeof(*cm));
+    size_t s = PAGE_SIZE;
+    while (s < span) s *= 2;
+
+    cm->base = arena->base;
+    cm->pages = arena->size / PAGE_SIZE;
+    cm->span = s;
+    cm->ncolors = s / PAGE_SIZE;
+
+    size_t contiguous = arena->huge_bytes == arena->size ? arena->page_size : PAGE_SIZE;
+    uint64_t *phys = NULL;
+    if (s > contiguous) {
+        phys = malloc(cm->pages * sizeof(uint64_t));
+        if (phys && pagemap_phys(arena->base, cm->pages, phys) == cm->pages) {
+            cm->physical = 1;
+        } else {
+            // pages we can't place are as good as random, fall back to virtual
+            free(phys);
+            phys = NULL;
+        }
+    } else {
+        cm->physical = 1;
+    }
+
+    cm->order = malloc(cm->pages * sizeof(uint32_t));
+    cm->start = calloc(cm->ncolors + 1, sizeof(size_t));
+    cm->used = calloc(cm->ncolors, sizeof(size_t));
+    if (!cm->order || !cm->start || !cm->used) {
+        perror("colors_init");
+        free(phys);
+        colors_free(cm);
+        return -1;
+    }
+
+    // counting sort of page indices by color
+    for (size_t p = 0; p < cm->pages; p++) cm->start[page_color(cm, phys, p) + 1]++;
+    for (size_t c = 0; c < cm->ncolors; c++) cm->start[c + 1] += cm->start[c];
+    size_t *fill = calloc(cm->ncolors, sizeof(size_t));
+    if (!fill) {
+        perror("colors_init");
+        free(phys);
+        colors_free(cm);
+        return -1;
+    }
+    for (size_t p = 0; p < cm->pages; p++) {
+        size_t c = page_color(cm, phys, p);
+        cm->order[cm->start[c] + fill[c]++] = (uint32_t)p;
+    }
+    free(fill);
+    free(phys);
+    return 0;
+}
+
+void colors_free(color_map_t *cm) {
+    free(cm->order);
+    free(cm->start);
+    free(cm->used);
+    cm->order = NULL;
+    cm->start = cm->used = NULL;
+}
+
+void colors_reset(color_map_t *cm) {
+    memset(cm->used, 0, cm->ncolors * sizeof(size_t));
+}
+
+// free pages left in a color
+size_t colors_left(const color_map_t *cm, size_t color) {
+    color %= cm->ncolors;
+    return cm->start[color + 1] - cm->start[color] - cm->used[color];
+}
+
+// next free page of the color, or NULL once it's used up
+char *color_alloc(color_map_t *cm, size_t color) {
+    color %= cm->ncolors;
+    if (colors_left(cm, color) == 0) return NULL;
+    size_t p = cm->order[cm->start[color] + cm->used[color]++];
+    return cm->base + p * PAGE_SIZE;
+}
+
+// up to max lines that all index set `set` of a cache with this map's span
+// and the given line size, one per page. returns how many it found.
+size_t color_lines(color_map_t *cm, size_t set, size_t line, char **out, size_t max) {
+    size_t off = set * line % cm->span;
+    size_t n = 0;
+    while (n < max) {
+        char *page = color_alloc(cm, off / PAGE_SIZE);
+        if (!page) break;
+        out[n++] = page + off % PAGE_SIZE;
+    }
+    return n;
+}
@@ -0,0 +1,200 @@
+// counters.c
+// optional hardware counters per point via perf_event_open. the timed part
+// of every trial is bracketed by counters_begin()/counters_end(), so each
+// latency row can carry its miss breakdown per access. if the PMU isn't
+// there (hypervisor, paranoid setting, no permission) we say so once and
+// everything keeps running in software-only mode.
+#define _GNU_SOURCE
+#include <cpuid.h>
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "memprobe.h"
+
+#define NUM_GROUPS 2
+
+typedef struct {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+    int group;             // events in a group are scheduled together
+} event_t;
+
+static event_t events[NUM_COUNTERS] = {
+    [CTR_CYCLES]       = { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, 0 },
+    [CTR_INSTRUCTIONS] = { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, 0 },
+    [CTR_L1D_MISS]     = { "L1D misses", PERF_TYPE_HW_CACHE,
+                           PERF_COUNT_HW_CACHE_L1D |
+                           (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), 0 },
+    [CTR_LLC_MISS]     = { "LLC misses", PERF_TYPE_HW_CACHE,
+                           PERF_COUNT_HW_CACHE_LL |
+                           (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), 0 },
+    [CTR_DTLB_MISS]    = { "dTLB misses", PERF_TYPE_HW_CACHE,
+                           PERF_COUNT_HW_CACHE_DTLB |
+                           (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), 1 },
+    // no generic event for these two, filled in per vendor below
+    [CTR_L2_MISS]      = { "L2 misses", PERF_TYPE_RAW, 0, 1 },
+    [CTR_WALKS]        = { "page walks", PERF_TYPE_RAW, 0, 1 },
+};
+
+static struct {
+    int active;
+    int fd[NUM_COUNTERS];
+    int leader[NUM_GROUPS];
+    int slot[NUM_COUNTERS];    // position in its group's read buffer
+    int nr[NUM_GROUPS];        // events opened in each group
+    double sum[NUM_COUNTERS];  // scaled counts since counters_reset()
+    uint64_t ops;
+} ctr;
+
+static long perf_event_open(struct perf_event_attr *attr, int group_fd) {
+    return syscall(SYS_perf_event_open, attr, 0, -1, group_fd, 0);
+}
+
+// Golden Cove and later: Alder/Raptor Lake, Sapphire/Emerald Rapids, Meteor,
+// Lunar and Arrow Lake, Granite Rapids
+static const unsigned golden_cove_models[] = {
+    0x97, 0x9a, 0xb7, 0xba, 0xbf, 0x8f, 0xcf, 0xaa, 0xac, 0xbd, 0xc5, 0xc6, 0xad, 0xae,
+};
+
+// raw codes for L2 data misses and completed page walks. Intel's page walk
+// event moved from 0x08 to 0x12 with Golden Cove; Ice/Tiger Lake still use 0x08.
+static void pick_raw_events(void) {
+    unsigned a = 0, b = 0, c = 0, d = 0;
+    char vendor[13] = { 0 };
+    __get_cpuid(0, &a, &b, &c, &d);
+    memcpy(vendor, &b, 4);
+    memcpy(vendor + 4, &d, 4);
+    memcpy(vendor + 8, &c, 4);
+
+    __get_cpuid(1, &a, &b, &c, &d);
+    unsigned family = (a >> 8) & 0xf;
+    unsigned model = (a >> 4) & 0xf;
+    if (family == 0x6 || family == 0xf) model |= ((a >> 16) & 0xf) << 4;
+    if (family == 0xf) family += (a >> 20) & 0xff;
+
+    if (strcmp(vendor, "GenuineIntel") == 0 && family == 6) {
+        int gc = 0;
+        for (size_t i = 0; i < sizeof(golden_cove_models) / sizeof(golden_cove_models[0]); i++) {
+            if (model == golden_cove_models[i]) gc = 1;
+        }
+        events[CTR_L2_MISS].config = 0x3f24;     // L2_RQSTS.MISS
+        events[CTR_WALKS].config = gc ? 0x0e12 : 0x0e08;
+    } else if (strcmp(vendor, "AuthenticAMD") == 0 &&
+               (family == 0x17 || family == 0x19 || family == 0x1a)) {
+        events[CTR_L2_MISS].config = 0x0864;     // L2CacheReqStat.LsRdBlkC
+        events[CTR_WALKS].config = 0xf045;       // LsL1DTlbMiss, L2 TLB miss
+    }
+}
+
+int counters_init(void) {
+    memset(&ctr, 0, sizeof(ctr));
+    for (int i = 0; i < NUM_COUNTERS; i++) ctr.fd[i] = -1;
+    for (int g = 0; g < NUM_GROUPS; g++) ctr.leader[g] = -1;
+    pick_raw_events();
+
+    int opened = 0;
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        if (events[i].type == PERF_TYPE_RAW && events[i].config == 0) continue;
+
+        int g = events[i].group;
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[i].type;
+        attr.config = events[i].config;
+        attr.disabled = ctr.leader[g] < 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP |
+                           PERF_FORMAT_TOTAL_TIME_ENABLED |
+                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        int fd = (int)perf_event_open(&attr, ctr.leader[g]);
+        if (fd < 0) {
+            if (i == CTR_CYCLES) {
+                fprintf(stderr, "counters: perf_event_open unavailable (%s), "
+                                "software-only mode\n", strerror(errno));
+                return -1;
+            }
+            fprintf(stderr, "counters: no %s (%s)\n", events[i].name, strerror(errno));
+            continue;
+        }
+        if (ctr.leader[g] < 0) ctr.leader[g] = fd;
+        ctr.fd[i] = fd;
+        ctr.slot[i] = ctr.nr[g]++;
+        opened++;
+    }
+
+    ctr.active = opened > 0;
+    return ctr.active ? 0 : -1;
+}
+
+void counters_close(void) {
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        if (ctr.fd[i] >= 0) close(ctr.fd[i]);
+        ctr.fd[i] = -1;
+    }
+    ctr.active = 0;
+}
+
+int counters_active(void) {
+    return ctr.active;
+}
+
+void counters_reset(void) {
+    memset(ctr.sum, 0, sizeof(ctr.sum));
+    ctr.ops = 0;
+}
+
+void counters_begin(void) {
+    if (!ctr.active) return;
+    for (int g = 0; g < NUM_GROUPS; g++) {
+        if (ctr.leader[g] < 0) continue;
+        ioctl(ctr.leader[g], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(ctr.leader[g], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+void counters_end(uint64_t ops) {
+    if (!ctr.active) return;
+    for (int g = 0; g < NUM_GROUPS; g++) {
+        if (ctr.leader[g] >= 0) {
+            ioctl(ctr.leader[g], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    for (int g = 0; g < NUM_GROUPS; g++) {
+        if (ctr.leader[g] < 0) continue;
+        uint64_t buf[3 + NUM_COUNTERS];
+        if (read(ctr.leader[g], buf, sizeof(buf)) < (ssize_t)(3 * sizeof(uint64_t))) continue;
+
+        // nr, time_enabled, time_running, values...
+        uint64_t enabled = buf[1], running = buf[2];
+        if (running == 0) continue;
+        // the group was multiplexed off part of the time, scale it back up
+        double scale = (double)enabled / (double)running;
+        for (int i = 0; i < NUM_COUNTERS; i++) {
+            if (ctr.fd[i] < 0 || events[i].group != g) continue;
+            ctr.sum[i] += buf[3 + ctr.slot[i]] * scale;
+        }
+    }
+    ctr.ops += ops;
+}
+
+// per-op averages since the last reset; -1 for events we couldn't open
+int counters_read(double *per_op) {
+    if (!ctr.active || ctr.ops == 0) return -1;
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        per_op[i] = ctr.fd[i] >= 0 ? ctr.sum[i] / (double)ctr.ops : -1.0;
+    }
+    return 0;
+}
@@ -0,0 +1,295 @@
+// engine.c
+// the bits every probe used to copy-paste: core pinning, the arena, cpu lists
+// and what sysfs says about the caches
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "memprobe.h"
+
+int pin_to_core(int core_id) {
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(core_id, &cpuset);
+
+    if (sched_setaffinity(0, sizeof(cpu_set_t), &cpuset) != 0) {
+        perror("sched_setaffinity");
+        return -1;
+    }
+    return 0;
+}
+
+int pin_to_mask(const cpumask_t *mask) {
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    for (int c = 0; c < MAX_CPUS && c < CPU_SETSIZE; c++) {
+        if (cpumask_test(mask, c)) CPU_SET(c, &cpuset);
+    }
+
+    if (sched_setaffinity(0, sizeof(cpu_set_t), &cpuset) != 0) {
+        perror("sched_setaffinity");
+        return -1;
+    }
+    return 0;
+}
+
+// probes that hop between cores put the process back where main() left it:
+// on --core if given, otherwise free to run anywhere
+void restore_affinity(const options_t *opt) {
+    if (opt->core >= 0) {
+        pin_to_core(opt->core);
+        return;
+    }
+    cpumask_t all;
+    if (online_cpus(&all) == 0) pin_to_mask(&all);
+}
+
+// kernel cpu list syntax: "0-3,8,10-11". returns -1 on garbage.
+int parse_cpu_list(const char *s, cpumask_t *mask) {
+    memset(mask, 0, sizeof(*mask));
+    while (*s && *s != '\n') {
+        char *end;
+        long lo = strtol(s, &end, 10);
+        if (end == s) return -1;
+        long hi = lo;
+        if (*end == '-') {
+            s = end + 1;
+            hi = strtol(s, &end, 10);
+            if (end == s) return -1;
+        }
+        for (long c = lo; c <= hi; c++) cpumask_set(mask, (int)c);
+        s = end;
+        if (*s == ',') s++;
+    }
+    return 0;
+}
+
+void format_cpu_list(const cpumask_t *mask, char *buf, size_t len) {
+    size_t used = 0;
+    buf[0] = '\0';
+    for (int c = 0; c < MAX_CPUS; c++) {
+        if (!cpumask_test(mask, c)) continue;
+        int hi = c;
+        while (hi + 1 < MAX_CPUS && cpumask_test(mask, hi + 1)) hi++;
+        int n = hi > c ? snprintf(buf + used, len - used, "%s%d-%d", used ? "," : "", c, hi)
+                       : snprintf(buf + used, len - used, "%s%d", used ? "," : "", c);
+        if (n < 0 || (size_t)n >= len - used) break;
+        used += n;
+        c = hi;
+    }
+}
+
+int cpumask_count(const cpumask_t *mask) {
+    int n = 0;
+    for (int i = 0; i < MAX_CPUS / 64; i++) n += __builtin_popcountll(mask->bits[i]);
+    return n;
+}
+
+static int read_line(const char *path, char *buf, size_t len) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    int ok = fgets(buf, (int)len, f) != NULL;
+    fclose(f);
+    if (!ok) return -1;
+    buf[strcspn(buf, "\n")] = '\0';
+    return 0;
+}
+
+int online_cpus(cpumask_t *mask) {
+    char buf[4096];
+    if (read_line("/sys/devices/system/cpu/online", buf, sizeof(buf)) != 0) return -1;
+    return parse_cpu_list(buf, mask);
+}
+
+// CPUs sharing cpu's data/unified cache at the given level, per sysfs
+int sysfs_cache_shared(int cpu, int level, cpumask_t *mask) {
+    char path[128], buf[4096];
+    for (int index = 0; index < 8; index++) {
+        snprintf(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu, index);
+        if (read_line(path, buf, sizeof(buf)) != 0) return -1;
+        if (atoi(buf) != level) continue;
+
+        snprintf(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%d/cache/index%d/type", cpu, index);
+        if (read_line(path, buf, sizeof(buf)) != 0) return -1;
+        if (strcmp(buf, "Instruction") == 0) continue;
+
+        snprintf(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list", cpu, index);
+        if (read_line(path, buf, sizeof(buf)) != 0) return -1;
+        return parse_cpu_list(buf, mask);
+    }
+    return -1;
+}
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+const char *pages_name(page_kind_t pages) {
+    switch (pages) {
+    case PAGES_THP: return "thp";
+    case PAGES_2M:  return "2m";
+    case PAGES_1G:  return "1g";
+    default:        return "4k";
+    }
+}
+
+// bytes of [base, base+size) that smaps reports as huge: AnonHugePages for
+// THP, the whole mapping when its KernelPageSize is already huge (hugetlbfs)
+static size_t smaps_huge_bytes(const char *base, size_t size) {
+    FILE *f = fopen("/proc/self/smaps", "r");
+    if (!f) return 0;
+
+    uintptr_t lo = (uintptr_t)base, hi = lo + size;
+    size_t huge = 0, vma_bytes = 0;
+    int inside = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long start, end, kb;
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            inside = start < hi && end > lo;
+            if (inside) {
+                uintptr_t s0 = start > lo ? start : lo, e0 = end < hi ? end : hi;
+                vma_bytes = e0 - s0;
+            }
+        } else if (inside && sscanf(line, "AnonHugePages: %lu kB", &kb) == 1) {
+            huge += kb * KB < vma_bytes ? kb * KB : vma_bytes;
+        } else if (inside && sscanf(line, "KernelPageSize: %lu kB", &kb) == 1) {
+            if (kb * KB > PAGE_SIZE) huge += vma_bytes;
+        }
+    }
+    fclose(f);
+    return huge < size ? huge : size;
+}
+
+int arena_init(arena_t *arena, size_t size, page_kind_t pages) {
+    size_t page = PAGE_SIZE;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    if (pages == PAGES_THP || pages == PAGES_2M) page = 2 * MB;
+    if (pages == PAGES_1G) page = 1024 * MB;
+    if (pages == PAGES_2M) flags |= MAP_HUGETLB | MAP_HUGE_2MB;
+    if (pages == PAGES_1G) flags |= MAP_HUGETLB | MAP_HUGE_1GB;
+
+    // round up to a whole number of pages
+    size = (size + page - 1) & ~(page - 1);
+
+    // THP only lines up on 2M boundaries, so map one huge page extra and
+    // start at the first aligned address inside
+    size_t map_size = pages == PAGES_THP ? size + page : size;
+    char *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (map == MAP_FAILED) {
+        perror("mmap arena");
+        if (pages == PAGES_2M || pages == PAGES_1G) {
+            fprintf(stderr, "no %s hugetlb pages free? see "
+                            "/sys/kernel/mm/hugepages/hugepages-%zukB/nr_hugepages\n",
+                    pages_name(pages), page / KB);
+        }
+        return -1;
+    }
+
+    char *mem = map;
+    if (pages == PAGES_THP) {
+        mem = (char *)(((uintptr_t)map + page - 1) & ~(uintptr_t)(page - 1));
+        if (madvise(mem, size, MADV_HUGEPAGE) != 0) perror("madvise MADV_HUGEPAGE");
+    } else if (pages == PAGES_4K) {
+        // with THP set to "always" a plain mapping could still get huge pages
+        madvise(mem, size, MADV_NOHUGEPAGE);
+    }
+
+    // touch every page now (after pinning) so the probes never see a page fault
+    memset(mem, 1, size);
+
+    arena->base = mem;
+    arena->size = size;
+    arena->pages = pages;
+    arena->page_size = page;
+    arena->map_base = map;
+    arena->map_size = map_size;
+    arena->huge_bytes = smaps_huge_bytes(mem, size);
+    return 0;
+}
+
+void arena_describe(const arena_t *arena) {
+    printf("Arena: %zu MB, %s pages, %zu MB (%.0f%%) on huge pages\n",
+           arena->size / MB, pages_name(arena->pages), arena->huge_bytes / MB,
+           100.0 * arena->huge_bytes / arena->size);
+}
+
+void arena_free(arena_t *arena) {
+    if (arena->map_base) munmap(arena->map_base, arena->map_size);
+    arena->base = arena->map_base = NULL;
+    arena->size = arena->map_size = 0;
+}
+
+// "4096", "48K", "2M", "1G" -> bytes. returns 0 on garbage.
+size_t parse_size(const char *s) {
+    char *end;
+    unsigned long long v = strtoull(s, &end, 0);
+    switch (*end) {
+    case 'k': case 'K': v *= KB; end++; break;
+    case 'm': case 'M': v *= MB; end++; break;
+    case 'g': case 'G': v *= 1024ULL * MB; end++; break;
+    }
+    if (*end == 'B' || *end == 'b') end++;
+    if (*end != '\0') return 0;
+    return (size_t)v;
+}
+
+// a numeric attribute of /sys/devices/system/cpu/cpuN/cache/indexI
+// ("size", "ways_of_associativity", "number_of_sets"...), or -1
+long sysfs_cache_value(int core, int index, const char *attr) {
+    char path[160];
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%d/cache/index%d/%s",
+             core < 0 ? 0 : core, index, attr);
+
+    char buf[32];
+    if (read_line(path, buf, sizeof(buf)) != 0) return -1;
+    size_t v = parse_size(buf);
+    return v ? (long)v : -1;
+}
+
+// size in bytes of /sys/devices/system/cpu/cpuN/cache/indexI, or -1
+long sysfs_cache_size(int core, int index) {
+    return sysfs_cache_value(core, index, "size");
+}
+
+// physical address of each page in [base, base + pages * PAGE_SIZE) from
+// /proc/self/pagemap. the kernel only hands out frame numbers to root, and
+// under a hypervisor they're guest-physical. entries it won't give are 0;
+// returns how many pages resolved.
+size_t pagemap_phys(const void *base, size_t pages, uint64_t *phys) {
+    memset(phys, 0, pages * sizeof(uint64_t));
+    int fd = open("/proc/self/pagemap", O_RDONLY);
+    if (fd < 0) return 0;
+
+    off_t off = (off_t)((uintptr_t)base / PAGE_SIZE * sizeof(uint64_t));
+    ssize_t got = pread(fd, phys, pages * sizeof(uint64_t), off);
+    close(fd);
+    if (got <= 0) {
+        memset(phys, 0, pages * sizeof(uint64_t));
+        return 0;
+    }
+
+    size_t resolved = 0;
+    for (size_t i = 0; i < pages; i++) {
+        uint64_t pfn = phys[i] & ((1ULL << 55) - 1);
+        int present = (phys[i] >> 63) & 1;
+        phys[i] = i < (size_t)got / sizeof(uint64_t) && present && pfn ? pfn * PAGE_SIZE : 0;
+        resolved += phys[i] != 0;
+    }
+    return resolved;
+}
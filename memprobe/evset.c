@@ -0,0 +1,225 @@
+// evset.c
+// LLC eviction sets by timing alone. a candidate set evicts a target when,
+// after loading the target and sweeping the set, reloading the target costs
+// a trip to memory. starting from a big pool of lines at one page offset
+// (which already evicts the target), group testing throws out whole chunks
+// at a time: split the set into ways + 1 chunks, at least one of them holds
+// no congruent line, drop the first one whose removal still evicts, repeat
+// until only `ways` lines are left. the result is one minimal set per
+// (slice, set) pair; which physical addresses end up together is what the
+// slice hash is recovered from.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memprobe.h"
+
+#define EVSET_VOTES 5          // reloads per eviction test, majority wins
+#define EVSET_CALIBRATE 31
+#define EVSET_SWEEPS 2         // passes over the set before the reload
+
+static volatile uint64_t evset_sink;
+
+static double median_of(double *v, int n) {
+    for (int i = 1; i < n; i++) {
+        double x = v[i];
+        int j = i - 1;
+        while (j >= 0 && v[j] > x) {
+            v[j + 1] = v[j];
+            j--;
+        }
+        v[j + 1] = x;
+    }
+    return v[n / 2];
+}
+
+static double timed_load(const char *p) {
+    uint64_t start = timer_start();
+    evset_sink += *(volatile const uint64_t *)p;
+    uint64_t end = timer_stop();
+    return timer_elapsed_ns(start, end, 1);
+}
+
+static void sweep(char **lines, size_t n) {
+    uint64_t x = 0;
+    for (int pass = 0; pass < EVSET_SWEEPS; pass++) {
+        for (size_t i = 0; i < n; i++) x += *(volatile const uint64_t *)lines[i];
+    }
+    evset_sink += x;
+}
+
+// a sweep over thousands of pages also evicts the target's TLB entry, and
+// the walk alone looks like a miss. touching another line of its page (half
+// a page away, out of reach of the adjacent-line prefetcher) brings the
+// translation back before the timed load.
+static double timed_reload(const char *target) {
+    const char *page = (const char *)((uintptr_t)target & ~(uintptr_t)(PAGE_SIZE - 1));
+    const char *other = page + (((uintptr_t)target + PAGE_SIZE / 2) & (PAGE_SIZE - 1));
+    evset_sink += *(volatile const uint64_t *)other;
+    _mm_lfence();
+    return timed_load(target);
+}
+
+// ns to reload target after touching it and sweeping lines
+double evset_reload_ns(char *target, char **lines, size_t n) {
+    evset_sink += *(volatile const uint64_t *)target;
+    sweep(lines, n);
+    return timed_reload(target);
+}
+
+int evset_evicts(evset_ctx_t *ev, char *target, char **lines, size_t n) {
+    int yes = 0;
+    ev->tests++;
+    for (int r = 0; r < EVSET_VOTES; r++) {
+        yes += evset_reload_ns(target, lines, n) > ev->threshold;
+        if (yes > EVSET_VOTES / 2 || r - yes >= EVSET_VOTES / 2) break;
+    }
+    return yes > EVSET_VOTES / 2;
+}
+
+// twice the L2, at the top of the arena
+static size_t flush_bytes(const probe_ctx_t *ctx) {
+    long l2 = sysfs_cache_size(ctx->opt.core, 2);
+    return 2 * (l2 > 0 ? (size_t)l2 : MB);
+}
+
+// median of EVSET_CALIBRATE reloads of the first pool line. i == 0, LLC
+// hit: after a sweep over twice the L2, which pushes it out of L1/L2 but
+// nowhere near out of the LLC. i == 1, memory: straight after clflush.
+double evset_reload_trial(void *arg, size_t i) {
+    evset_ctx_t *ev = arg;
+    char *target = ev->pool[0];
+    size_t bytes = flush_bytes(ev->ctx);
+    char *flush = ev->ctx->arena.base + ev->ctx->arena.size - bytes;
+
+    double ns[EVSET_CALIBRATE];
+    for (int r = 0; r < EVSET_CALIBRATE; r++) {
+        evset_sink += *(volatile const uint64_t *)target;
+        if (i == 0) {
+            uint64_t x = 0;
+            for (size_t off = 0; off < bytes; off += CACHE_LINE_SIZE) {
+                x += *(volatile const uint64_t *)(flush + off);
+            }
+            evset_sink += x;
+        } else {
+            _mm_clflush(target);
+            _mm_mfence();
+        }
+        ns[r] = timed_reload(target);
+    }
+    return median_of(ns, EVSET_CALIBRATE);
+}
+
+void evset_calibrate(evset_ctx_t *ev, double hit_ns, double miss_ns) {
+    ev->hit_ns = hit_ns;
+    ev->miss_ns = miss_ns;
+    ev->threshold = 0.5 * (hit_ns + miss_ns);
+}
+
+// pool: the line at `offset` in each of the first pool_lines arena pages,
+// short of the calibration buffer at the top
+int evset_init(evset_ctx_t *ev, probe_ctx_t *ctx, size_t offset, size_t pool_lines,
+               size_t ways) {
+    memset(ev, 0, sizeof(*ev));
+    ev->ctx = ctx;
+    ev->ways = ways;
+
+    size_t max_lines = (ctx->arena.size - flush_bytes(ctx)) / PAGE_SIZE;
+    if (pool_lines > max_lines) pool_lines = max_lines;
+    ev->pool = malloc(pool_lines * sizeof(char *));
+    ev->scratch = malloc(pool_lines * sizeof(char *));
+    if (!ev->pool || !ev->scratch) {
+        perror("evset_init");
+        evset_free(ev);
+        return -1;
+    }
+    for (size_t i = 0; i < pool_lines; i++) {
+        ev->pool[i] = ctx->arena.base + i * PAGE_SIZE + offset % PAGE_SIZE;
+    }
+    ev->npool = pool_lines;
+
+    evset_calibrate(ev, evset_reload_trial(ev, 0), evset_reload_trial(ev, 1));
+    return 0;
+}
+
+void evset_free(evset_ctx_t *ev) {
+    free(ev->pool);
+    free(ev->scratch);
+    ev->pool = ev->scratch = NULL;
+}
+
+// trim the pool to one doubling past the shortest one (from `start` lines)
+// whose sweep evicts its first line, headroom for targets in fuller sets.
+// returns the new pool size, 0 if even all of it doesn't (the arena is too
+// small for this LLC).
+size_t evset_fit_pool(evset_ctx_t *ev, size_t start) {
+    size_t n = start < ev->npool ? start : ev->npool;
+    for (;;) {
+        if (evset_evicts(ev, ev->pool[0], ev->pool + 1, n - 1)) {
+            if (2 * n < ev->npool) ev->npool = 2 * n;
+            return ev->npool;
+        }
+        if (n == ev->npool) return 0;
+        n = 2 * n < ev->npool ? 2 * n : ev->npool;
+    }
+}
+
+// shrink lines[0..n) in place to a minimal set still evicting target.
+// returns the new size, or 0 if group testing got stuck (noise, or the
+// set never evicted in the first place).
+size_t evset_reduce(evset_ctx_t *ev, char *target, char **lines, size_t n) {
+    if (!evset_evicts(ev, target, lines, n)) return 0;
+
+    size_t ways = ev->ways;
+    while (n > ways) {
+        size_t chunks = ways + 1 < n ? ways + 1 : n;
+        int dropped = 0;
+        for (size_t c = 0; c < chunks && !dropped; c++) {
+            size_t lo = n * c / chunks, hi = n * (c + 1) / chunks;
+            // the set without chunk c
+            size_t m = 0;
+            for (size_t i = 0; i < n; i++) {
+                if (i < lo || i >= hi) ev->scratch[m++] = lines[i];
+            }
+            if (evset_evicts(ev, target, ev->scratch, m)) {
+                memcpy(lines, ev->scratch, m * sizeof(char *));
+                n = m;
+                dropped = 1;
+            }
+        }
+        if (!dropped) return 0;
+    }
+    return n;
+}
+
+// a minimal eviction set for target out of the pool (minus the target),
+// shuffled differently on every attempt. returns its size or 0.
+size_t evset_build(evset_ctx_t *ev, char *target, char **out, int attempts) {
+    for (int a = 0; a < attempts; a++) {
+        size_t n = 0;
+        for (size_t i = 0; i < ev->npool; i++) {
+            if (ev->pool[i] != target) out[n++] = ev->pool[i];
+        }
+        for (size_t i = n - 1; i > 0; i--) {
+            size_t k = (size_t)(chain_rand() % (i + 1));
+            char *temp = out[i];
+            out[i] = out[k];
+            out[k] = temp;
+        }
+        size_t got = evset_reduce(ev, target, out, n);
+        if (got) return got;
+    }
+    return 0;
+}
+
+// pool lines outside set[0..n) that the set evicts, i.e. congruent with it,
+// up to max of them. returns how many it found.
+size_t evset_congruent(evset_ctx_t *ev, char **set, size_t n, char **out, size_t max) {
+    size_t found = 0;
+    for (size_t i = 0; i < ev->npool && found < max; i++) {
+        int member = 0;
+        for (size_t k = 0; k < n && !member; k++) member = set[k] == ev->pool[i];
+        if (!member && evset_evicts(ev, ev->pool[i], set, n)) out[found++] = ev->pool[i];
+    }
+    return found;
+}
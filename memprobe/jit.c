@@ -0,0 +1,107 @@
+// jit.c
+// tiny x86-64 code emitter for the code-side probes. generated functions
+// take one argument, a repeat count in rdi, and loop over their body that
+// many times before returning. buffers are plain RWX anonymous mappings
+// kept on 4k pages, so the iTLB sees the pages we lay out.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "memprobe.h"
+
+// the recommended multi-byte NOPs up to 11 bytes: the 8-byte form behind
+// at most three 0x66/0x2e prefixes. longer NOPs would need more prefixes,
+// and many cores stall decode on more than three, so we stop there.
+static const unsigned char nops[JIT_MAX_NOP][JIT_MAX_NOP] = {
+    { 0x90 },
+    { 0x66, 0x90 },
+    { 0x0f, 0x1f, 0x00 },
+    { 0x0f, 0x1f, 0x40, 0x00 },
+    { 0x0f, 0x1f, 0x44, 0x00, 0x00 },
+    { 0x66, 0x0f, 0x1f, 0x44, 0x00, 0x00 },
+    { 0x0f, 0x1f, 0x80, 0x00, 0x00, 0x00, 0x00 },
+    { 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+    { 0x66, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+    { 0x66, 0x2e, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+    { 0x66, 0x66, 0x2e, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+};
+
+int jit_alloc(jit_buf_t *j, size_t size) {
+    size = (size + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE | PROT_EXEC,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) {
+        perror("mmap code");
+        j->base = NULL;
+        j->size = 0;
+        return -1;
+    }
+    madvise(p, size, MADV_NOHUGEPAGE);
+    j->base = p;
+    j->size = size;
+    return 0;
+}
+
+void jit_free(jit_buf_t *j) {
+    if (j->base) munmap(j->base, j->size);
+    j->base = NULL;
+    j->size = 0;
+}
+
+static unsigned char *put_rel32(unsigned char *at, const unsigned char *to) {
+    int32_t rel = (int32_t)(to - (at + 4));
+    memcpy(at, &rel, 4);
+    return at + 4;
+}
+
+// raw machine code
+unsigned char *jit_bytes(unsigned char *at, const void *bytes, size_t n) {
+    memcpy(at, bytes, n);
+    return at + n;
+}
+
+// jmp rel32, 5 bytes
+unsigned char *jit_jmp(unsigned char *at, const unsigned char *to) {
+    *at++ = 0xe9;
+    return put_rel32(at, to);
+}
+
+// call rel32, 5 bytes
+unsigned char *jit_call(unsigned char *at, const unsigned char *to) {
+    *at++ = 0xe8;
+    return put_rel32(at, to);
+}
+
+unsigned char *jit_ret(unsigned char *at) {
+    *at++ = 0xc3;
+    return at;
+}
+
+// one NOP of len bytes, 1..JIT_MAX_NOP
+unsigned char *jit_nop(unsigned char *at, int len) {
+    if (len < 1) len = 1;
+    if (len > JIT_MAX_NOP) len = JIT_MAX_NOP;
+    memcpy(at, nops[len - 1], (size_t)len);
+    return at + len;
+}
+
+// dec rdi; jnz top -- 9 bytes
+unsigned char *jit_loop(unsigned char *at, const unsigned char *top) {
+    *at++ = 0x48;
+    *at++ = 0xff;
+    *at++ = 0xcf;
+    *at++ = 0x0f;
+    *at++ = 0x85;
+    return put_rel32(at, top);
+}
+
+// dec rdi; jnz top; ret -- 10 bytes
+unsigned char *jit_loop_tail(unsigned char *at, const unsigned char *top) {
+    return jit_ret(jit_loop(at, top));
+}
+
+// no-op on x86, but keeps the generated code honest about self-modification
+void jit_done(const jit_buf_t *j, size_t used) {
+    __builtin___clear_cache((char *)j->base, (char *)j->base + used);
+}
@@ -0,0 +1,161 @@
+// measure.c
+// repeated trials per point. a point keeps running trials until the 95%
+// confidence interval of its median is tight enough, or the trial budget
+// runs out. points are visited in random order so slow drift (thermals,
+// frequency) smears across the sweep instead of looking like a cache edge.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memprobe.h"
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// nearest-rank percentile of a sorted sample
+static double percentile(const double *v, int n, double p) {
+    int k = (int)ceil(p / 100.0 * n) - 1;
+    if (k < 0) k = 0;
+    if (k >= n) k = n - 1;
+    return v[k];
+}
+
+// median, p5/p95 and a distribution-free 95% CI for the median: the order
+// statistics n/2 -+ 1.96*sqrt(n)/2 (normal approximation of the binomial)
+static void summarize(double *v, int n, stats_t *st) {
+    qsort(v, n, sizeof(double), cmp_double);
+
+    double sum = 0;
+    for (int i = 0; i < n; i++) sum += v[i];
+
+    st->trials = n;
+    st->mean = sum / n;
+    st->median = (n & 1) ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+    st->p5 = percentile(v, n, 5);
+    st->p95 = percentile(v, n, 95);
+
+    double half = 1.96 * sqrt((double)n) / 2.0;
+    int lo = (int)floor(n / 2.0 - half);
+    int hi = (int)ceil(n / 2.0 + half);
+    if (lo < 0) lo = 0;
+    if (hi > n - 1) hi = n - 1;
+    st->ci_lo = v[lo];
+    st->ci_hi = v[hi];
+}
+
+static void measure_trials(const options_t *opt, trial_fn trial, void *arg, size_t i,
+                           stats_t *st) {
+    double samples[MAX_TRIALS];
+    double sorted[MAX_TRIALS];
+    int max_trials = opt->max_trials < MAX_TRIALS ? opt->max_trials : MAX_TRIALS;
+    int min_trials = opt->min_trials < max_trials ? opt->min_trials : max_trials;
+    int n = 0;
+
+    counters_reset();
+    while (n < max_trials) {
+        double v = trial(arg, i);
+        if (v < 0) {
+            // the point couldn't be set up: leave it empty (trials == 0)
+            memset(st, 0, sizeof(*st));
+            return;
+        }
+        samples[n++] = v;
+        if (n < min_trials) continue;
+
+        for (int k = 0; k < n; k++) sorted[k] = samples[k];
+        summarize(sorted, n, st);
+        if (st->median > 0 &&
+            (st->ci_hi - st->ci_lo) <= st->median * opt->ci_target / 100.0) {
+            break;
+        }
+    }
+    for (int k = 0; k < n; k++) sorted[k] = samples[k];
+    summarize(sorted, n, st);
+    st->have_counters = counters_read(st->counters) == 0;
+}
+
+// one chase point outside a sweep, recorded under label in ns/access
+void measure_point(const options_t *opt, trial_fn trial, void *arg, size_t i,
+                   const char *label, stats_t *st) {
+    measure_trials(opt, trial, arg, i, st);
+    if (st->trials) results_add(label, NULL, st);
+}
+
+// hand the sweep to results.c in index order, named by the probe if it can
+static void record_points(size_t n, const point_ops_t *ops, const stats_t *out) {
+    int sweep = results_sweep();
+    for (size_t i = 0; i < n; i++) {
+        if (!out[i].trials) continue;
+        char label[96];
+        if (ops->label) ops->label(ops->arg, i, label, sizeof(label));
+        else snprintf(label, sizeof(label), "sweep %d point %zu", sweep, i);
+        results_add(label, ops->unit, &out[i]);
+    }
+}
+
+void measure_points(probe_ctx_t *ctx, size_t n, const point_ops_t *ops,
+                    stats_t *out) {
+    size_t *order = malloc(n * sizeof(size_t));
+    if (!order) {
+        // no room to shuffle, sweep in order
+        for (size_t i = 0; i < n; i++) {
+            if (ops->setup) ops->setup(ops->arg, i);
+            measure_trials(&ctx->opt, ops->trial, ops->arg, i, &out[i]);
+        }
+        record_points(n, ops, out);
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++) order[i] = i;
+    for (size_t i = n; i > 1; i--) {
+        size_t j = (size_t)(chain_rand() % i);
+        size_t temp = order[i - 1];
+        order[i - 1] = order[j];
+        order[j] = temp;
+    }
+
+    for (size_t k = 0; k < n; k++) {
+        size_t i = order[k];
+        if (ops->setup) ops->setup(ops->arg, i);
+        measure_trials(&ctx->opt, ops->trial, ops->arg, i, &out[i]);
+    }
+    free(order);
+    record_points(n, ops, out);
+}
+
+double chase_trial(void *arg, size_t i) {
+    chase_point_t *cp = arg;
+    (void)i;
+    return chase_ns(cp->head, 0, cp->ctx->opt.iterations);
+}
+
+void print_stats_header(const char *label) {
+    printf("%s\tMedian(ns)\tCycles\tP5\tP95\tCI95\t\tTrials", label);
+    if (counters_active()) {
+        printf("\t| Cyc/acc\tIns/acc\tL1D\tL2\tLLC\tdTLB\tWalks");
+    }
+    printf("\n----------------------------------------------------------------------------");
+    if (counters_active()) {
+        printf("------------------------------------------------------------");
+    }
+    printf("\n");
+}
+
+static void print_counter(double v) {
+    if (v < 0) printf("\t-");
+    else printf("\t%.3f", v);
+}
+
+void print_stats_row(const char *label, const stats_t *st) {
+    printf("%s\t\t%.4f\t\t%.1f\t%.3f\t%.3f\t%.3f-%.3f\t%d", label, st->median,
+           st->median * timer.core_ghz, st->p5, st->p95, st->ci_lo, st->ci_hi,
+           st->trials);
+    if (st->have_counters) {
+        printf("\t|");
+        for (int i = 0; i < NUM_COUNTERS; i++) print_counter(st->counters[i]);
+    }
+    printf("\n");
+}
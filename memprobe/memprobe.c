@@ -0,0 +1,323 @@
+// memprobe.c
+// one binary for every probe. pins once, allocates one arena, then runs the
+// requested subcommand (or all of them) on top of the shared engine.
+//
+// build: gcc -O2 -Wall -pthread -o memprobe/memprobe memprobe/*.c -lm
+// usage: memprobe/memprobe [--core=N] [--arena=SIZE] [--pages=4k|thp|2m|1g] [--iters=N] [--seed=N]
+//                         [--build-threads=N] [--trials=N] [--max-trials=N] [--ci=PCT]
+//                         [--timer=tsc|clock] [--counters] [-v] [--per-type]
+//                         [--json=FILE] [--csv=FILE] <probe|all> [probe options]
+//        memprobe/memprobe [-v] compare [--threshold=PCT] BASELINE NEW
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "memprobe.h"
+
+static const probe_t probes[] = {
+    { "size",   "cache size, random chase over growing working sets", probe_size },
+    { "line",   "cache line size, strided chase",                     probe_line },
+    { "assoc",  "associativity, same-set chain of growing length",    probe_assoc },
+    { "tlb",    "TLB reach, one node per page",                       probe_tlb },
+    { "page",   "page size, fixed node count at growing stride",      probe_page },
+    { "icache", "instruction cache size, NOP sleds",                  probe_icache },
+    { "mlp",    "outstanding misses, 1..K independent chains",        probe_mlp },
+    { "bw",     "SIMD load/store/copy/triad/rmw bandwidth per size",  probe_bw },
+    { "nt",     "non-temporal vs regular stores, rep stosb/movsb",    probe_nt },
+    { "share",  "which cores share each cache level, pairwise eviction", probe_share },
+    { "c2c",    "core-to-core cache line round trip, N x N matrix",   probe_c2c },
+    { "walk",   "page walk cost per paging level, 4k/2m/1g pages",    probe_walk },
+    { "evset",  "minimal LLC eviction sets, slices and slice hash",    probe_evset },
+    { "policy", "replacement policy per level, simulated vs measured", probe_policy },
+    { "prefetch", "prefetcher coverage per access pattern and stride", probe_prefetch },
+    { "code",   "code fetch: jump chains at line/page spacing, L1i/L2/iTLB", probe_code },
+    { "decode", "op cache vs legacy decode, NOP loops of 1-11 byte mixes", probe_decode },
+    { "branch", "BTB capacity, return stack depth, pattern history length", probe_branch },
+    { "store",  "store forwarding by size/offset, store buffer capacity", probe_store },
+    { NULL, NULL, NULL }
+};
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: memprobe [options] <probe|all> [probe options]\n"
+            "\n"
+            "Options:\n"
+            "  --core=N       pin to core N before allocating (default: don't pin)\n"
+            "  --arena=SIZE   preallocated data arena (default 256M)\n"
+            "  --pages=KIND   arena pages: 4k, thp (madvise), 2m or 1g (hugetlbfs)\n"
+            "                 (default 4k)\n"
+            "  --iters=N      timed accesses per trial (default 200000)\n"
+            "  --trials=N     trials every point gets (default 5)\n"
+            "  --max-trials=N trial budget for noisy points (default 50)\n"
+            "  --ci=PCT       stop once the median's 95%% CI is within PCT%% (default 1)\n"
+            "  --timer=KIND   tsc (rdtscp, calibrated) or clock (default tsc)\n"
+            "  --counters     per-point cache/TLB miss breakdown from perf_event_open\n"
+            "  -v, --verbose  print every point, not just the summary\n"
+            "  --per-type     run once per core type (P/E-cores), side by side\n"
+            "  --seed=N       shuffle seed (default: time)\n"
+            "  --build-threads=N\n"
+            "                 threads for building chains of 256M and up (default 1)\n"
+            "  --json=FILE    also write every point, with a machine fingerprint, as JSON\n"
+            "  --csv=FILE     the same as CSV\n"
+            "\n"
+            "Probes:\n");
+    for (int i = 0; probes[i].name; i++) {
+        fprintf(stderr, "  %-8s %s\n", probes[i].name, probes[i].summary);
+    }
+    fprintf(stderr, "  %-8s %s\n", "all", "every probe above with default options");
+    fprintf(stderr,
+            "\n"
+            "Usage: memprobe [-v] compare [--threshold=PCT] BASELINE NEW\n"
+            "  flag points of two --json/--csv runs whose medians moved by more than PCT\n"
+            "  (default 5) with disjoint 95%% CIs; -v lists every point. exits 2 if any\n"
+            "  point got slower.\n");
+}
+
+// one probe, or every probe with default options when probe is NULL
+static int run_probes(probe_ctx_t *ctx, const probe_t *probe, int argc, char **argv) {
+    if (probe) {
+        results_probe(probe->name);
+        return probe->run(ctx, argc, argv);
+    }
+
+    int rc = 0;
+    for (int i = 0; probes[i].name; i++) {
+        char *sub_argv[] = { (char *)probes[i].name, NULL };
+        results_probe(probes[i].name);
+        rc |= probes[i].run(ctx, 1, sub_argv);
+        printf("\n");
+    }
+    return rc;
+}
+
+// print captured outputs as columns, tabs expanded so the tables line up
+static void print_side_by_side(char **out, int n) {
+    char *pos[MAX_CORE_TYPES];
+    size_t width[MAX_CORE_TYPES];
+    for (int t = 0; t < n; t++) {
+        pos[t] = out[t];
+        width[t] = 0;
+        size_t col = 0;
+        for (const char *p = out[t]; *p; p++) {
+            if (*p == '\n') col = 0;
+            else col = *p == '\t' ? (col / 8 + 1) * 8 : col + 1;
+            if (col > width[t]) width[t] = col;
+        }
+    }
+
+    for (;;) {
+        int more = 0;
+        for (int t = 0; t < n; t++) more |= *pos[t] != '\0';
+        if (!more) break;
+
+        for (int t = 0; t < n; t++) {
+            size_t col = 0;
+            for (; *pos[t] && *pos[t] != '\n'; pos[t]++) {
+                if (*pos[t] == '\t') {
+                    do putchar(' '); while (++col % 8);
+                } else {
+                    putchar(*pos[t]);
+                    col++;
+                }
+            }
+            if (*pos[t] == '\n') pos[t]++;
+            if (t == n - 1) break;
+            for (; col < width[t]; col++) putchar(' ');
+            printf(" | ");
+        }
+        printf("\n");
+    }
+}
+
+// run the probe once on the first cpu of every core type. each run goes
+// into its own buffer with its own timer calibration, then they're printed
+// next to each other.
+static int run_per_type(probe_ctx_t *ctx, const probe_t *probe, int argc, char **argv) {
+    core_type_t types[MAX_CORE_TYPES];
+    const char *source = "";
+    int n = core_types(types, &source);
+
+    char buf[256];
+    printf("Core types (%s):", source);
+    for (int t = 0; t < n; t++) {
+        format_cpu_list(&types[t].cpus, buf, sizeof(buf));
+        printf(" %s {%s}", types[t].name, buf);
+    }
+    printf("\n");
+    if (n < 2) {
+        printf("one core type, running once\n\n");
+        return run_probes(ctx, probe, argc, argv);
+    }
+
+    char *out[MAX_CORE_TYPES];
+    size_t len[MAX_CORE_TYPES];
+    int saved_core = ctx->opt.core;
+    FILE *real_stdout = stdout;
+    int rc = 0;
+
+    fflush(stdout);
+    for (int t = 0; t < n; t++) {
+        int cpu = first_cpu(&types[t].cpus);
+        FILE *f = open_memstream(&out[t], &len[t]);
+        if (!f) {
+            perror("open_memstream");
+            for (int k = 0; k < t; k++) free(out[k]);
+            return 1;
+        }
+        stdout = f;
+        printf("== %s (cpu %d) ==\n", types[t].name, cpu);
+        if (pin_to_core(cpu) == 0) {
+            ctx->opt.core = cpu;
+            timer_init(ctx->opt.timer);
+            timer_describe();
+            results_variant(types[t].name);
+            rc |= run_probes(ctx, probe, argc, argv);
+        } else {
+            rc = 1;
+        }
+        fclose(f);
+        stdout = real_stdout;
+    }
+
+    ctx->opt.core = saved_core;
+    results_variant(NULL);
+    restore_affinity(&ctx->opt);
+    print_side_by_side(out, n);
+    for (int t = 0; t < n; t++) free(out[t]);
+    return rc;
+}
+
+static const probe_t *find_probe(const char *name) {
+    for (int i = 0; probes[i].name; i++) {
+        if (strcmp(probes[i].name, name) == 0) return &probes[i];
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    probe_ctx_t ctx = {
+        .opt = {
+            .core = -1,
+            .arena_bytes = 256 * MB,
+            .iterations = 200000,
+            .seed = (uint64_t)time(NULL),
+            .build_threads = 1,
+            .min_trials = 5,
+            .max_trials = 50,
+            .ci_target = 1.0,
+            .timer = TIMER_TSC,
+        },
+    };
+    const char *json_path = NULL, *csv_path = NULL;
+
+    static const struct option longopts[] = {
+        { "core",  required_argument, NULL, 'c' },
+        { "arena", required_argument, NULL, 'a' },
+        { "pages", required_argument, NULL, 'p' },
+        { "iters", required_argument, NULL, 'i' },
+        { "seed",  required_argument, NULL, 's' },
+        { "build-threads", required_argument, NULL, 'b' },
+        { "trials", required_argument, NULL, 't' },
+        { "max-trials", required_argument, NULL, 'T' },
+        { "ci", required_argument, NULL, 'C' },
+        { "timer", required_argument, NULL, 'k' },
+        { "counters", no_argument, NULL, 'P' },
+        { "verbose", no_argument, NULL, 'v' },
+        { "per-type", no_argument, NULL, 'Y' },
+        { "json",  required_argument, NULL, 'J' },
+        { "csv",   required_argument, NULL, 'V' },
+        { "help",  no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    // '+' stops at the subcommand so its options are left for the probe
+    while ((c = getopt_long(argc, argv, "+hv", longopts, NULL)) != -1) {
+        switch (c) {
+        case 'c': ctx.opt.core = atoi(optarg); break;
+        case 'a': ctx.opt.arena_bytes = parse_size(optarg); break;
+        case 'p':
+            if (strcmp(optarg, "4k") == 0) ctx.opt.pages = PAGES_4K;
+            else if (strcmp(optarg, "thp") == 0) ctx.opt.pages = PAGES_THP;
+            else if (strcmp(optarg, "2m") == 0) ctx.opt.pages = PAGES_2M;
+            else if (strcmp(optarg, "1g") == 0) ctx.opt.pages = PAGES_1G;
+            else { usage(); return 1; }
+            break;
+        case 'i': ctx.opt.iterations = strtoull(optarg, NULL, 0); break;
+        case 's': ctx.opt.seed = strtoull(optarg, NULL, 0); break;
+        case 'b': ctx.opt.build_threads = atoi(optarg); break;
+        case 't': ctx.opt.min_trials = atoi(optarg); break;
+        case 'T': ctx.opt.max_trials = atoi(optarg); break;
+        case 'C': ctx.opt.ci_target = atof(optarg); break;
+        case 'k':
+            if (strcmp(optarg, "tsc") == 0) ctx.opt.timer = TIMER_TSC;
+            else if (strcmp(optarg, "clock") == 0) ctx.opt.timer = TIMER_CLOCK;
+            else { usage(); return 1; }
+            break;
+        case 'P': ctx.opt.counters = 1; break;
+        case 'v': ctx.opt.verbose = 1; break;
+        case 'Y': ctx.opt.per_type = 1; break;
+        case 'J': json_path = optarg; break;
+        case 'V': csv_path = optarg; break;
+        case 'h': usage(); return 0;
+        default: usage(); return 1;
+        }
+    }
+    if (optind >= argc) {
+        usage();
+        return 1;
+    }
+    if (ctx.opt.arena_bytes == 0 || ctx.opt.iterations == 0) {
+        fprintf(stderr, "arena and iters must be non-zero\n");
+        return 1;
+    }
+    if (ctx.opt.min_trials < 1 || ctx.opt.max_trials < ctx.opt.min_trials ||
+        ctx.opt.max_trials > MAX_TRIALS) {
+        fprintf(stderr, "need 1 <= trials <= max-trials <= %d\n", MAX_TRIALS);
+        return 1;
+    }
+
+    const char *name = argv[optind];
+    // compare only reads files, no pinning or arena
+    if (strcmp(name, "compare") == 0) {
+        return results_compare(argc - optind, argv + optind, ctx.opt.verbose);
+    }
+    const probe_t *probe = NULL;
+    if (strcmp(name, "all") != 0) {
+        probe = find_probe(name);
+        if (!probe) {
+            fprintf(stderr, "unknown probe '%s'\n", name);
+            usage();
+            return 1;
+        }
+    }
+
+    // pin first so the arena gets faulted in on this core's memory node
+    if (ctx.opt.core >= 0) {
+        if (pin_to_core(ctx.opt.core) != 0) return 1;
+        printf("Pinned to Core %d\n", ctx.opt.core);
+    }
+    // calibrate after pinning so the core clock is the one we'll run on
+    timer_init(ctx.opt.timer);
+    timer_describe();
+    if (ctx.opt.counters) counters_init();
+    chain_seed(ctx.opt.seed);
+    chain_threads(ctx.opt.build_threads);
+    if (arena_init(&ctx.arena, ctx.opt.arena_bytes, ctx.opt.pages) != 0) return 1;
+    arena_describe(&ctx.arena);
+    if (json_path || csv_path) {
+        results_enable();
+        results_fingerprint(&ctx, argc, argv);
+    }
+
+    int rc;
+    if (ctx.opt.per_type) rc = run_per_type(&ctx, probe, argc - optind, argv + optind);
+    else rc = run_probes(&ctx, probe, argc - optind, argv + optind);
+
+    if ((json_path || csv_path) && results_write(json_path, csv_path) != 0) rc = 1;
+    counters_close();
+    arena_free(&ctx.arena);
+    return rc;
+}
@@ -0,0 +1,333 @@
+// memprobe.h
+// shared pieces of the memprobe engine: options, the arena, the chain builder,
+// the timer and the probe table. every probe subcommand is built on these.
+#ifndef MEMPROBE_H
+#define MEMPROBE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <x86intrin.h>
+
+#define CACHE_LINE_SIZE 64
+#define PAGE_SIZE 4096
+
+#define KB (1024UL)
+#define MB (1024UL * 1024UL)
+
+#define MAX_TRIALS 256
+#define MAX_CPUS 1024
+
+// plain bitmap of CPU ids, so the header doesn't need _GNU_SOURCE's cpu_set_t
+typedef struct {
+    uint64_t bits[MAX_CPUS / 64];
+} cpumask_t;
+
+static inline void cpumask_set(cpumask_t *m, int cpu) {
+    if (cpu >= 0 && cpu < MAX_CPUS) m->bits[cpu / 64] |= 1ULL << (cpu % 64);
+}
+
+static inline int cpumask_test(const cpumask_t *m, int cpu) {
+    return cpu >= 0 && cpu < MAX_CPUS && ((m->bits[cpu / 64] >> (cpu % 64)) & 1);
+}
+
+// what backs the arena
+typedef enum {
+    PAGES_4K,      // plain mmap, THP explicitly off
+    PAGES_THP,     // 2M-aligned mmap + MADV_HUGEPAGE
+    PAGES_2M,      // MAP_HUGETLB, 2M hugetlbfs pages
+    PAGES_1G,      // MAP_HUGETLB, 1G hugetlbfs pages
+} page_kind_t;
+
+// one kind of core on a hybrid part, and the cpus of that kind
+#define MAX_CORE_TYPES 8
+typedef struct {
+    char name[48];
+    cpumask_t cpus;
+} core_type_t;
+
+typedef enum {
+    TIMER_CLOCK,   // clock_gettime(CLOCK_MONOTONIC)
+    TIMER_TSC,     // serialized rdtsc/rdtscp, calibrated to ns
+} timer_kind_t;
+
+// global options, parsed before the subcommand name
+typedef struct {
+    int core;              // core to pin to, -1 leaves affinity alone
+    size_t arena_bytes;    // size of the preallocated data arena
+    page_kind_t pages;     // page size backing the arena
+    size_t iterations;     // timed accesses per measurement point
+    uint64_t seed;         // seed for the chain shuffles
+    int build_threads;     // threads for building multi-GB chains
+    int min_trials;        // trials every point gets
+    int max_trials;        // trial budget for noisy points
+    double ci_target;      // stop once the median's 95% CI is this % wide
+    timer_kind_t timer;
+    int counters;          // collect perf counters per point
+    int verbose;           // full per-point tables for summarizing probes
+    int per_type;          // run once per core type, side by side
+} options_t;
+
+typedef struct {
+    timer_kind_t kind;
+    double ticks_per_ns;   // 1.0 for clock
+    uint64_t overhead;     // ticks of an empty start/stop pair
+    double core_ghz;       // measured core clock, for ns -> cycles
+} timer_state_t;
+
+extern timer_state_t timer;
+
+// one big prefaulted buffer that every probe carves its working set out of,
+// so we pay for the page faults once instead of once per size
+typedef struct {
+    char *base;
+    size_t size;
+    page_kind_t pages;
+    size_t page_size;      // size the arena was rounded up to
+    size_t huge_bytes;     // bytes smaps says are on huge pages
+    char *map_base;        // the whole mapping, wider than base/size for THP
+    size_t map_size;
+} arena_t;
+
+typedef struct {
+    options_t opt;
+    arena_t arena;
+} probe_ctx_t;
+
+// arena pages sorted by cache color (frame number mod span / PAGE_SIZE)
+typedef struct {
+    char *base;
+    size_t pages;
+    size_t span;           // set span the colors are for, power of two
+    size_t ncolors;
+    int physical;          // colors are real, not just virtual guesses
+    uint32_t *order;       // page indices grouped by color
+    size_t *start;         // color c is order[start[c] .. start[c + 1])
+    size_t *used;          // pages handed out per color
+} color_map_t;
+
+// timing-based eviction set search over a pool of same-offset lines
+typedef struct {
+    probe_ctx_t *ctx;
+    size_t ways;           // size a minimal set is reduced to
+    double hit_ns;         // single reload served by the LLC
+    double miss_ns;        // single reload from memory
+    double threshold;      // above this a reload counts as evicted
+    char **pool;           // candidate lines, one per arena page
+    size_t npool;
+    char **scratch;        // group-testing workspace, npool entries
+    size_t tests;          // eviction tests run so far
+} evset_ctx_t;
+
+// RWX buffer for generated code. NOPs stop at 11 bytes, the longest
+// without piling on more than three prefixes.
+#define JIT_MAX_NOP 11
+typedef struct {
+    unsigned char *base;
+    size_t size;
+} jit_buf_t;
+
+// generated code: loops over its body rdi times
+typedef void (*jit_fn)(uint64_t reps);
+
+// hardware events counted per point when --counters is on
+typedef enum {
+    CTR_CYCLES,
+    CTR_INSTRUCTIONS,
+    CTR_L1D_MISS,
+    CTR_L2_MISS,
+    CTR_LLC_MISS,
+    CTR_DTLB_MISS,
+    CTR_WALKS,
+    NUM_COUNTERS
+} counter_id_t;
+
+// summary of one point's trials, all in ns per access
+typedef struct {
+    int trials;
+    double mean;
+    double median;
+    double p5, p95;
+    double ci_lo, ci_hi;   // 95% confidence interval of the median
+    int have_counters;
+    double counters[NUM_COUNTERS];  // per access over all trials, -1 = n/a
+} stats_t;
+
+// one timed trial of point i, returns ns per access. a negative return
+// means the point couldn't be set up; it's left with trials == 0.
+typedef double (*trial_fn)(void *arg, size_t i);
+
+// how measure_points() drives a sweep: setup(i) once (build the chain,
+// warm up), then trial(i) until the point converges. label(i) names the
+// point in --json/--csv output; unit is what a trial's ns are per.
+typedef struct {
+    void (*setup)(void *arg, size_t i);
+    trial_fn trial;
+    void *arg;
+    void (*label)(void *arg, size_t i, char *buf, size_t len);
+    const char *unit;      // NULL: "ns/access"
+} point_ops_t;
+
+// the common case: each point is one chain and a trial just times it.
+// probe sweep structs start with this so chase_trial() can drive them.
+typedef struct {
+    probe_ctx_t *ctx;
+    void **head;
+} chase_point_t;
+
+// a latency step found by the size search: working sets up to lo fit the
+// level, from hi on they spill, with the latencies either side
+typedef struct {
+    size_t lo, hi;
+    double lo_ns, hi_ns;
+} cache_edge_t;
+
+typedef struct {
+    const char *name;
+    const char *summary;
+    int (*run)(probe_ctx_t *ctx, int argc, char **argv);
+} probe_t;
+
+// timer.c
+uint64_t get_time_ns(void);
+int timer_init(timer_kind_t kind);
+const char *timer_name(void);
+void timer_describe(void);
+double timer_elapsed_ns(uint64_t start, uint64_t stop, uint64_t ops);
+
+// lfence keeps earlier instructions from drifting past the start read
+static inline uint64_t timer_start(void) {
+    if (timer.kind == TIMER_CLOCK) return get_time_ns();
+    _mm_lfence();
+    uint64_t t = __rdtsc();
+    _mm_lfence();
+    return t;
+}
+
+// rdtscp waits for everything before it, lfence for nothing after it to start
+static inline uint64_t timer_stop(void) {
+    if (timer.kind == TIMER_CLOCK) return get_time_ns();
+    unsigned aux;
+    uint64_t t = __rdtscp(&aux);
+    _mm_lfence();
+    return t;
+}
+
+// counters.c
+int counters_init(void);
+void counters_close(void);
+int counters_active(void);
+void counters_reset(void);
+void counters_begin(void);
+void counters_end(uint64_t ops);
+int counters_read(double *per_op);
+
+// engine.c
+int pin_to_core(int core_id);
+int pin_to_mask(const cpumask_t *mask);
+void restore_affinity(const options_t *opt);
+int parse_cpu_list(const char *s, cpumask_t *mask);
+void format_cpu_list(const cpumask_t *mask, char *buf, size_t len);
+int cpumask_count(const cpumask_t *mask);
+int online_cpus(cpumask_t *mask);
+int sysfs_cache_shared(int cpu, int level, cpumask_t *mask);
+int arena_init(arena_t *arena, size_t size, page_kind_t pages);
+const char *pages_name(page_kind_t pages);
+void arena_describe(const arena_t *arena);
+void arena_free(arena_t *arena);
+size_t parse_size(const char *s);
+long sysfs_cache_value(int core, int index, const char *attr);
+long sysfs_cache_size(int core, int index);
+size_t pagemap_phys(const void *base, size_t pages, uint64_t *phys);
+
+// topology.c
+int core_types(core_type_t *types, const char **source);
+int first_cpu(const cpumask_t *mask);
+int under_hypervisor(void);
+
+// colors.c
+int colors_init(color_map_t *cm, const arena_t *arena, size_t span);
+void colors_free(color_map_t *cm);
+void colors_reset(color_map_t *cm);
+size_t colors_left(const color_map_t *cm, size_t color);
+char *color_alloc(color_map_t *cm, size_t color);
+size_t color_lines(color_map_t *cm, size_t set, size_t line, char **out, size_t max);
+
+// evset.c
+int evset_init(evset_ctx_t *ev, probe_ctx_t *ctx, size_t offset, size_t pool_lines,
+               size_t ways);
+void evset_free(evset_ctx_t *ev);
+double evset_reload_trial(void *arg, size_t i);
+void evset_calibrate(evset_ctx_t *ev, double hit_ns, double miss_ns);
+double evset_reload_ns(char *target, char **lines, size_t n);
+int evset_evicts(evset_ctx_t *ev, char *target, char **lines, size_t n);
+size_t evset_fit_pool(evset_ctx_t *ev, size_t start);
+size_t evset_reduce(evset_ctx_t *ev, char *target, char **lines, size_t n);
+size_t evset_build(evset_ctx_t *ev, char *target, char **out, int attempts);
+size_t evset_congruent(evset_ctx_t *ev, char **set, size_t n, char **out, size_t max);
+
+// jit.c
+int jit_alloc(jit_buf_t *j, size_t size);
+void jit_free(jit_buf_t *j);
+unsigned char *jit_bytes(unsigned char *at, const void *bytes, size_t n);
+unsigned char *jit_jmp(unsigned char *at, const unsigned char *to);
+unsigned char *jit_call(unsigned char *at, const unsigned char *to);
+unsigned char *jit_ret(unsigned char *at);
+unsigned char *jit_nop(unsigned char *at, int len);
+unsigned char *jit_loop(unsigned char *at, const unsigned char *top);
+unsigned char *jit_loop_tail(unsigned char *at, const unsigned char *top);
+void jit_done(const jit_buf_t *j, size_t used);
+
+// chain.c
+void chain_seed(uint64_t seed);
+void chain_threads(int threads);
+uint64_t chain_rand(void);
+void **chain_random(char *base, size_t bytes, size_t stride);
+void **chain_strided(char *base, size_t count, size_t stride);
+void **chain_pages(char *base, size_t count, size_t page);
+void **chain_list(char **nodes, size_t count);
+void **chase(void **p, size_t steps);
+double chase_ns(void **head, size_t warmup, size_t iterations);
+
+// measure.c
+void measure_point(const options_t *opt, trial_fn trial, void *arg, size_t i,
+                   const char *label, stats_t *st);
+void measure_points(probe_ctx_t *ctx, size_t n, const point_ops_t *ops,
+                    stats_t *out);
+double chase_trial(void *arg, size_t i);
+void print_stats_header(const char *label);
+void print_stats_row(const char *label, const stats_t *st);
+
+// results.c
+void results_enable(void);
+void results_fingerprint(const probe_ctx_t *ctx, int argc, char **argv);
+void results_probe(const char *probe);
+void results_variant(const char *variant);
+int results_sweep(void);
+void results_add(const char *label, const char *unit, const stats_t *st);
+int results_write(const char *json_path, const char *csv_path);
+int results_compare(int argc, char **argv, int verbose);
+
+// probes
+int cache_edges(probe_ctx_t *ctx, size_t min_bytes, size_t max_bytes, double precision,
+                cache_edge_t *edges, int max_edges);
+int probe_size(probe_ctx_t *ctx, int argc, char **argv);
+int probe_line(probe_ctx_t *ctx, int argc, char **argv);
+int probe_assoc(probe_ctx_t *ctx, int argc, char **argv);
+int probe_tlb(probe_ctx_t *ctx, int argc, char **argv);
+int probe_page(probe_ctx_t *ctx, int argc, char **argv);
+int probe_icache(probe_ctx_t *ctx, int argc, char **argv);
+int probe_mlp(probe_ctx_t *ctx, int argc, char **argv);
+int probe_bw(probe_ctx_t *ctx, int argc, char **argv);
+int probe_nt(probe_ctx_t *ctx, int argc, char **argv);
+int probe_share(probe_ctx_t *ctx, int argc, char **argv);
+int probe_c2c(probe_ctx_t *ctx, int argc, char **argv);
+int probe_walk(probe_ctx_t *ctx, int argc, char **argv);
+int probe_evset(probe_ctx_t *ctx, int argc, char **argv);
+int probe_policy(probe_ctx_t *ctx, int argc, char **argv);
+int probe_prefetch(probe_ctx_t *ctx, int argc, char **argv);
+int probe_code(probe_ctx_t *ctx, int argc, char **argv);
+int probe_decode(probe_ctx_t *ctx, int argc, char **argv);
+int probe_branch(probe_ctx_t *ctx, int argc, char **argv);
+int probe_store(probe_ctx_t *ctx, int argc, char **argv);
+
+#endif
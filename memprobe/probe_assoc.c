@@ -0,0 +1,337 @@
+// probe_assoc.c
+// associativity probe: chain N addresses that all map to the same set.
+// once N passes the number of ways the set thrashes and latency jumps.
+//
+// --auto does it for L1d, L2 and the LLC without hints. level sizes come
+// from the size probe's edge search. line sizes come from sysfs per level
+// (coherency_line_size), since the line probe only sees the line of the
+// level its region misses in; --line overrides it for every level.
+//
+// for a stride S below the set span (sets * line), lines S apart spread
+// over several sets and the largest N that still fits is capacity / S;
+// from the span on it stops shrinking and stays at the way count. so we
+// double S until N stops halving, which gives ways and span (and sets)
+// together. L2 and the LLC are indexed by physical address, so above a
+// page the "S apart" lines are picked by frame number from pagemap (or
+// inside huge pages) rather than by virtual stride. an LLC split into
+// hashed slices shows ways x slices.
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memprobe.h"
+
+#define MAX_WAYS 32        // upper bound on associativity
+#define AUTO_MAX_N 256     // most same-set lines --auto will chain
+#define FLAT_RATIO 1.5     // N(S/2) / N(S) below this means S/2 was the span
+#define EDGE_PRECISION 5.0 // % the size search resolves level edges to
+
+typedef struct {
+    chase_point_t cp;
+    size_t stride;
+    char *lines[MAX_WAYS]; // --set: lines of one physical set, else unused
+    int colored;
+    char what[48];         // the set under test, for point labels
+} assoc_sweep_t;
+
+// point i is a chain of i + 1 ways
+static void assoc_setup(void *arg, size_t i) {
+    assoc_sweep_t *sw = arg;
+    if (sw->colored) sw->cp.head = chain_list(sw->lines, i + 1);
+    else sw->cp.head = chain_strided(sw->cp.ctx->arena.base, i + 1, sw->stride);
+    sw->cp.head = chase(sw->cp.head, 1000);
+}
+
+static void assoc_label(void *arg, size_t i, char *buf, size_t len) {
+    const assoc_sweep_t *sw = arg;
+    snprintf(buf, len, "%s %zu ways", sw->what, i + 1);
+}
+
+typedef struct {
+    const char *name;
+    int index;             // sysfs cache/indexN
+    size_t max_n;
+} auto_level_t;
+
+static const auto_level_t auto_levels[] = {
+    { "L1d", 0, 64 },
+    { "L2",  2, 64 },
+    { "LLC", 3, AUTO_MAX_N },
+};
+#define NUM_AUTO_LEVELS 3
+
+typedef struct {
+    probe_ctx_t *ctx;
+    const char *level;     // level and stride being fitted, for point labels
+    size_t stride;
+    size_t line;
+    int physical;          // the last pick_lines() used real frame numbers
+    char *lines[AUTO_MAX_N];
+    char *order[AUTO_MAX_N];
+} auto_state_t;
+
+// up to want lines that agree in their address bits below S, physical bits
+// once S is past a page. returns how many it found.
+static size_t pick_lines(auto_state_t *a, size_t S, size_t want) {
+    size_t n = 0;
+    a->physical = 1;
+    if (S <= PAGE_SIZE) {
+        for (size_t off = 0; off + a->line <= a->ctx->arena.size && n < want; off += S) {
+            a->lines[n++] = a->ctx->arena.base + off;
+        }
+        return n;
+    }
+
+    color_map_t cm;
+    if (colors_init(&cm, &a->ctx->arena, S) != 0) return 0;
+    n = color_lines(&cm, 0, a->line, a->lines, want);
+    a->physical = cm.physical;
+    colors_free(&cm);
+    return n;
+}
+
+// median ns per hop over the first n picked lines in one random cycle
+static double same_set_latency(auto_state_t *a, size_t n) {
+    for (size_t j = 0; j < n; j++) a->order[j] = a->lines[j];
+    for (size_t i = n - 1; i > 0; i--) {
+        size_t k = (size_t)(chain_rand() % (i + 1));
+        char *temp = a->order[i];
+        a->order[i] = a->order[k];
+        a->order[k] = temp;
+    }
+
+    chase_point_t cp = { a->ctx, chain_list(a->order, n) };
+    cp.head = chase(cp.head, n * 8);
+    char label[64];
+    snprintf(label, sizeof(label), "%s stride %zu B %zu lines", a->level, a->stride, n);
+    stats_t st;
+    measure_point(&a->ctx->opt, chase_trial, &cp, 0, label, &st);
+    return st.median;
+}
+
+static double plateau(probe_ctx_t *ctx, size_t bytes, const char *label) {
+    if (bytes > ctx->arena.size) bytes = ctx->arena.size;
+    chase_point_t cp = { ctx, chain_random(ctx->arena.base, bytes, CACHE_LINE_SIZE) };
+    cp.head = chase(cp.head, bytes / CACHE_LINE_SIZE);
+    stats_t st;
+    measure_point(&ctx->opt, chase_trial, &cp, 0, label, &st);
+    return st.median;
+}
+
+// largest n <= have whose same-set chain stays under threshold
+static size_t fit_count(auto_state_t *a, size_t have, double threshold) {
+    if (have < 2 || same_set_latency(a, have) <= threshold) return have;
+    size_t lo = 1, hi = have;   // lo fits, hi doesn't
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (same_set_latency(a, mid) <= threshold) lo = mid;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static int assoc_sweep(probe_ctx_t *ctx, assoc_sweep_t *sw) {
+    point_ops_t ops = { assoc_setup, chase_trial, sw, assoc_label };
+    stats_t st[MAX_WAYS];
+    measure_points(ctx, MAX_WAYS, &ops, st);
+
+    print_stats_header("Ways");
+    for (int i = 0; i < MAX_WAYS; i++) {
+        char label[32];
+        snprintf(label, sizeof(label), "%d", i + 1);
+        print_stats_row(label, &st[i]);
+    }
+
+    return 0;
+}
+
+static int assoc_auto(probe_ctx_t *ctx, size_t line_opt) {
+    static auto_state_t a;
+    a.ctx = ctx;
+
+    printf("Associativity Probe (auto)\n");
+
+    // measured sizes: the largest working set that still fit each level.
+    // a level the search found no edge for falls back to sysfs.
+    cache_edge_t edges[NUM_AUTO_LEVELS];
+    int nedges = cache_edges(ctx, 4 * KB, ctx->arena.size, EDGE_PRECISION, edges,
+                             NUM_AUTO_LEVELS);
+    printf("\n");
+
+    long size[NUM_AUTO_LEVELS];
+    int measured[NUM_AUTO_LEVELS];
+    size_t line[NUM_AUTO_LEVELS];
+    double lat[NUM_AUTO_LEVELS + 1];
+    for (int l = 0; l < NUM_AUTO_LEVELS; l++) {
+        measured[l] = l < nedges;
+        size[l] = measured[l] ? (long)edges[l].lo
+                              : sysfs_cache_size(ctx->opt.core, auto_levels[l].index);
+        long coherency = sysfs_cache_value(ctx->opt.core, auto_levels[l].index,
+                                           "coherency_line_size");
+        line[l] = line_opt ? line_opt : coherency > 0 ? (size_t)coherency : CACHE_LINE_SIZE;
+        char label[32];
+        snprintf(label, sizeof(label), "%s hit", auto_levels[l].name);
+        lat[l] = size[l] > 0 ? plateau(ctx, (size_t)size[l] / 2, label) : 0;
+    }
+    long llc = size[NUM_AUTO_LEVELS - 1] > 0 ? size[NUM_AUTO_LEVELS - 1] : (long)(32 * MB);
+    lat[NUM_AUTO_LEVELS] = plateau(ctx, (size_t)llc * 4, "memory");
+
+    printf("Level\tSize(KB)\tLine\tWays\tSets\tSpan(KB)\t| sysfs ways/sets\tnote\n");
+    printf("--------------------------------------------------------------------------------\n");
+    for (int l = 0; l < NUM_AUTO_LEVELS; l++) {
+        if (size[l] <= 0) continue;
+        // halfway (geometric) between hitting this level and the next
+        double threshold = sqrt(lat[l] * lat[l + 1]);
+        size_t max_n = auto_levels[l].max_n;
+        a.level = auto_levels[l].name;
+        a.line = line[l];
+
+        size_t S = a.line;
+        while (S * max_n < 2 * (size_t)size[l]) S *= 2;
+        size_t prev_n = 0, prev_s = 0, ways = 0, span = 0;
+        int virtual_only = 0, saturated = 0;
+        for (; S <= 4 * (size_t)size[l]; S *= 2) {
+            a.stride = S;
+            size_t have = pick_lines(&a, S, max_n);
+            virtual_only |= !a.physical;
+            size_t n = fit_count(&a, have, threshold);
+            if (ctx->opt.verbose) {
+                printf("  %s stride %zu KB: %zu lines fit (of %zu)\n",
+                       auto_levels[l].name, S / KB, n, have);
+            }
+            // every line fit: says nothing about the sets, try a wider stride
+            if (n == have) {
+                saturated = 1;
+                prev_n = 0;
+                continue;
+            }
+            if (prev_n && (double)prev_n / n < FLAT_RATIO) {
+                ways = prev_n;
+                span = prev_s;
+                break;
+            }
+            prev_n = n;
+            prev_s = S;
+        }
+
+        long sys_ways = sysfs_cache_value(ctx->opt.core, auto_levels[l].index,
+                                          "ways_of_associativity");
+        long sys_sets = sysfs_cache_value(ctx->opt.core, auto_levels[l].index,
+                                          "number_of_sets");
+        printf("%s\t%ld%s\t\t%zu\t", auto_levels[l].name, size[l] / (long)KB,
+               measured[l] ? "" : "*", a.line);
+        if (ways) {
+            printf("%zu\t%zu\t%zu\t\t| %ld/%ld\t\t", ways, span / a.line, span / KB,
+                   sys_ways, sys_sets);
+        } else {
+            printf("?\t?\t?\t\t| %ld/%ld\t\t", sys_ways, sys_sets);
+        }
+        if (!ways && saturated && !virtual_only && under_hypervisor())
+            printf("same-color lines never conflict: pagemap is guest-physical here");
+        else if (!ways && saturated)
+            printf("same-set lines never conflict: index bits above a page not under our control");
+        else if (!ways) printf("no flat region up to %zu KB stride", 4 * (size_t)size[l] / KB);
+        else if (sys_ways > 0 && ways >= 2 * (size_t)sys_ways)
+            printf("~%zu hashed slices of %ld ways", ways / sys_ways, sys_ways);
+        else if (virtual_only) printf("virtual stride only, physical index bits guessed");
+        printf("\n");
+    }
+    if (nedges < NUM_AUTO_LEVELS) printf("* no edge found, sysfs size\n");
+
+    return 0;
+}
+
+int probe_assoc(probe_ctx_t *ctx, int argc, char **argv) {
+    size_t cache_size = 0;
+    size_t stride = 0;
+    size_t line = 0;       // --auto: per level from sysfs
+    size_t span = 0;
+    long set = -1;
+    int autodetect = 0;
+
+    static const struct option longopts[] = {
+        { "cache-size", required_argument, NULL, 'c' },
+        { "stride",     required_argument, NULL, 's' },
+        { "auto",       no_argument,       NULL, 'A' },
+        { "line",       required_argument, NULL, 'l' },
+        { "set",        required_argument, NULL, 'S' },
+        { "span",       required_argument, NULL, 'p' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+        case 'c': cache_size = parse_size(optarg); break;
+        case 's': stride = parse_size(optarg); break;
+        case 'A': autodetect = 1; break;
+        case 'l': line = parse_size(optarg); break;
+        case 'S': set = atol(optarg); break;
+        case 'p': span = parse_size(optarg); break;
+        default:
+            fprintf(stderr, "Usage: memprobe assoc [--cache-size=SIZE | --stride=BYTES]\n"
+                            "       memprobe assoc --set=N [--span=BYTES] [--line=BYTES]\n"
+                            "       memprobe assoc --auto [--line=BYTES]\n");
+            return 1;
+        }
+    }
+    if (autodetect) {
+        if (line && (line < sizeof(void *) || (line & (line - 1)))) {
+            fprintf(stderr, "assoc: --line must be a power of two\n");
+            return 1;
+        }
+        return assoc_auto(ctx, line);
+    }
+    if (line == 0) line = CACHE_LINE_SIZE;
+
+    static assoc_sweep_t sw;
+    memset(&sw, 0, sizeof(sw));
+    sw.cp.ctx = ctx;
+    if (set >= 0) {
+        // one exact set: by default of L2, whose index bits go past the page
+        if (span == 0) {
+            long sets = sysfs_cache_value(ctx->opt.core, 2, "number_of_sets");
+            span = sets > 0 ? (size_t)sets * line : MB;
+        }
+        color_map_t cm;
+        if (colors_init(&cm, &ctx->arena, span) != 0) return 1;
+        size_t n = color_lines(&cm, (size_t)set, line, sw.lines, MAX_WAYS);
+        int physical = cm.physical;
+        colors_free(&cm);
+        if (n < MAX_WAYS) {
+            fprintf(stderr, "assoc: only %zu pages of that color in the arena, need %d\n",
+                    n, MAX_WAYS);
+            return 1;
+        }
+        sw.colored = 1;
+        snprintf(sw.what, sizeof(sw.what), "set %ld of %zu KB", set, cm.span / KB);
+        printf("Associativity Probe (Set %ld of a %zu KB span, %s)\n", set, cm.span / KB,
+               physical ? "physical" : "virtual only, pagemap unavailable");
+        return assoc_sweep(ctx, &sw);
+    }
+
+    if (stride == 0) {
+        // no hint given, fall back to what the kernel says L1d is
+        if (cache_size == 0) {
+            long l1d = sysfs_cache_size(ctx->opt.core, 0);
+            cache_size = l1d > 0 ? (size_t)l1d : 48 * KB;
+        }
+        // approximate number of sets
+        size_t num_sets_guess = cache_size / (CACHE_LINE_SIZE * MAX_WAYS);
+        if (num_sets_guess == 0) num_sets_guess = 1;
+        stride = num_sets_guess * CACHE_LINE_SIZE;
+    }
+
+    if ((size_t)MAX_WAYS * stride > ctx->arena.size) {
+        fprintf(stderr, "assoc: stride %zu needs %zu bytes, arena is %zu\n",
+                stride, (size_t)MAX_WAYS * stride, ctx->arena.size);
+        return 1;
+    }
+
+    printf("Associativity Probe (Stride = %zu bytes)\n", stride);
+    sw.stride = stride;
+    snprintf(sw.what, sizeof(sw.what), "stride %zu B", stride);
+    return assoc_sweep(ctx, &sw);
+}
@@ -0,0 +1,346 @@
+// probe_branch.c
+// branch predictor structures, all on JIT-built code (jit.c).
+//
+// btb: N unconditional jumps S bytes apart, each to the next. while all N
+// fit in the BTB the front end follows them at about one per cycle; past
+// that every jump is found only at decode and costs a resteer. large
+// spacings put all jumps in a few BTB sets, so the capacity seen at 4K
+// spacing is close to the ways of one set. wide spacings also leave the
+// L1i and the iTLB early; the code probe shows where.
+//
+// rsb: D nested calls, each level returning through one shared ret. with
+// D above the return stack depth the outer returns find their entries
+// overwritten, and the BTB can't stand in: the shared ret's target changes
+// every time. each of those costs a mispredict.
+//
+// pht: one conditional branch following a random pattern of period P. the
+// predictor learns periods its history covers; beyond that it is a coin
+// flip, half the branches mispredict.
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memprobe.h"
+
+#define MAX_POINTS 256
+#define MIN_BRANCHES 8
+#define MAX_BRANCHES 16384
+#define MAX_FOOTPRINT (64 * MB)
+#define MAX_DEPTH 64
+#define MAX_PERIOD 65536
+#define BASE_POINTS 3              // points the baseline is the best of
+#define PENALTY_RATIO 2.0          // cost over baseline that marks the limit
+#define MISPREDICT_RATE 0.05       // pht: rate that marks the limit
+
+static const size_t spacings[] = { 16, 64, 256, 4096 };
+#define NUM_SPACINGS ((int)(sizeof(spacings) / sizeof(spacings[0])))
+
+typedef void (*pattern_fn)(uint64_t reps, const uint8_t *pattern, uint64_t period);
+
+typedef struct {
+    probe_ctx_t *ctx;
+    jit_buf_t jit;
+    size_t counts[MAX_POINTS];     // branches, depths or periods per point
+    size_t ncounts;
+    uint64_t reps;
+    size_t per_rep;                // timed events per rep
+    jit_fn fn;
+    uint8_t *pattern;
+    size_t period;
+} branch_sweep_t;
+
+static double cycles(double ns) {
+    return ns * timer.core_ghz;
+}
+
+// no code for the point (it didn't fit the buffer): skip it
+static double jit_trial(void *arg, size_t i) {
+    branch_sweep_t *sw = arg;
+    (void)i;
+    if (!sw->fn) return -1.0;
+
+    counters_begin();
+    uint64_t start = timer_start();
+    if (sw->pattern) ((pattern_fn)(void *)sw->fn)(sw->reps, sw->pattern, sw->period);
+    else sw->fn(sw->reps);
+    uint64_t end = timer_stop();
+    counters_end(sw->reps * sw->per_rep);
+
+    return timer_elapsed_ns(start, end, sw->reps * sw->per_rep);
+}
+
+static void set_reps(branch_sweep_t *sw, size_t per_rep) {
+    sw->per_rep = per_rep;
+    sw->reps = sw->ctx->opt.iterations / per_rep;
+    if (sw->reps == 0) sw->reps = 1;
+}
+
+// first point whose cost passes the baseline by PENALTY_RATIO and stays
+// there for the next point too (a lone spike is noise), 0 if none
+static size_t knee(const stats_t *st, size_t n, size_t stride, double *base) {
+    *base = 0;
+    for (size_t k = 0; k < BASE_POINTS && k < n; k++) {
+        double c = st[k * stride].median;
+        if (c > 0 && (*base == 0 || c < *base)) *base = c;
+    }
+    for (size_t k = 1; k < n; k++) {
+        if (st[k * stride].median <= PENALTY_RATIO * *base) continue;
+        if (k + 1 == n || st[(k + 1) * stride].median > PENALTY_RATIO * *base) return k;
+    }
+    return 0;
+}
+
+// two counts per octave from lo up to hi
+static size_t fill_counts(branch_sweep_t *sw, size_t lo, size_t hi, size_t per_count) {
+    sw->ncounts = 0;
+    for (size_t c = lo; c <= hi && (sw->ncounts + 2) * per_count <= MAX_POINTS; c *= 2) {
+        sw->counts[sw->ncounts++] = c;
+        if (c + c / 2 <= hi && c >= 2) sw->counts[sw->ncounts++] = c + c / 2;
+    }
+    return sw->ncounts;
+}
+
+// btb point i: count i / NUM_SPACINGS, spacing i % NUM_SPACINGS
+static void btb_setup(void *arg, size_t i) {
+    branch_sweep_t *sw = arg;
+    size_t n = sw->counts[i / NUM_SPACINGS];
+    size_t spacing = spacings[i % NUM_SPACINGS];
+    sw->fn = NULL;
+    if (n * spacing > sw->jit.size) return;
+
+    unsigned char *code = sw->jit.base;
+    for (size_t k = 0; k + 1 < n; k++) jit_jmp(code + k * spacing, code + (k + 1) * spacing);
+    jit_loop_tail(code + (n - 1) * spacing, code);
+    jit_done(&sw->jit, n * spacing);
+
+    set_reps(sw, n);
+    sw->fn = (jit_fn)(void *)code;
+    sw->fn(sw->reps); // warm up
+}
+
+static void btb_label(void *arg, size_t i, char *buf, size_t len) {
+    const branch_sweep_t *sw = arg;
+    snprintf(buf, len, "btb %zu x %zu B", sw->counts[i / NUM_SPACINGS],
+             spacings[i % NUM_SPACINGS]);
+}
+
+// rsb point i: depth counts[i]. shared ret at 0, level k at 64 (k + 1),
+// the loop that calls level 0 after the deepest level.
+static void rsb_setup(void *arg, size_t i) {
+    branch_sweep_t *sw = arg;
+    size_t depth = sw->counts[i];
+    unsigned char *code = sw->jit.base;
+
+    jit_ret(code);
+    for (size_t k = 0; k < depth; k++) {
+        unsigned char *at = code + (k + 1) * CACHE_LINE_SIZE;
+        if (k + 1 < depth) at = jit_call(at, code + (k + 2) * CACHE_LINE_SIZE);
+        jit_jmp(at, code);
+    }
+    unsigned char *entry = code + (depth + 1) * CACHE_LINE_SIZE;
+    jit_loop_tail(jit_call(entry, code + CACHE_LINE_SIZE), entry);
+    jit_done(&sw->jit, (depth + 2) * CACHE_LINE_SIZE);
+
+    set_reps(sw, depth);
+    sw->fn = (jit_fn)(void *)entry;
+    sw->fn(sw->reps);
+}
+
+static void rsb_label(void *arg, size_t i, char *buf, size_t len) {
+    const branch_sweep_t *sw = arg;
+    snprintf(buf, len, "rsb depth %zu", sw->counts[i]);
+}
+
+// pht: rdi reps, rsi pattern bytes, rdx period
+static const unsigned char pht_prologue[] = {
+    0x31, 0xc9,                    // xor ecx, ecx
+    0x45, 0x31, 0xc0,              // xor r8d, r8d
+};
+static const unsigned char pht_body[] = {
+    0x0f, 0xb6, 0x04, 0x0e,        // movzx eax, byte [rsi + rcx]
+    0x48, 0xff, 0xc1,              // inc rcx
+    0x48, 0x39, 0xd1,              // cmp rcx, rdx
+    0x49, 0x0f, 0x44, 0xc8,        // cmove rcx, r8
+    0x85, 0xc0,                    // test eax, eax
+    0x74, 0x01,                    // jz +1, the patterned branch
+    0x90,                          // nop
+};
+
+static void pht_setup(void *arg, size_t i) {
+    branch_sweep_t *sw = arg;
+    sw->period = sw->counts[i];
+    // random bits, but never all one way
+    size_t ones;
+    do {
+        ones = 0;
+        for (size_t k = 0; k < sw->period; k++) {
+            sw->pattern[k] = (uint8_t)(chain_rand() & 1);
+            ones += sw->pattern[k];
+        }
+    } while (ones == 0 || ones == sw->period);
+
+    unsigned char *at = jit_bytes(sw->jit.base, pht_prologue, sizeof(pht_prologue));
+    unsigned char *top = at;
+    at = jit_bytes(at, pht_body, sizeof(pht_body));
+    at = jit_loop_tail(at, top);
+    jit_done(&sw->jit, (size_t)(at - sw->jit.base));
+
+    set_reps(sw, 1);
+    sw->fn = (jit_fn)(void *)sw->jit.base;
+    ((pattern_fn)(void *)sw->fn)(sw->reps, sw->pattern, sw->period);
+}
+
+static void pht_label(void *arg, size_t i, char *buf, size_t len) {
+    const branch_sweep_t *sw = arg;
+    snprintf(buf, len, "pht period %zu", sw->counts[i]);
+}
+
+static void run_btb(branch_sweep_t *sw) {
+    size_t n = fill_counts(sw, MIN_BRANCHES, MAX_BRANCHES, NUM_SPACINGS) * NUM_SPACINGS;
+    static stats_t st[MAX_POINTS];
+    point_ops_t ops = { btb_setup, jit_trial, sw, btb_label, "ns/jump" };
+    measure_points(sw->ctx, n, &ops, st);
+
+    printf("\nBTB (cycles per taken jump)\n");
+    printf("Branches");
+    for (int s = 0; s < NUM_SPACINGS; s++) printf("\t%zu B apart", spacings[s]);
+    printf("\n------------------------------------------------------------\n");
+    for (size_t c = 0; c < sw->ncounts; c++) {
+        printf("%zu\t", sw->counts[c]);
+        for (int s = 0; s < NUM_SPACINGS; s++) {
+            double ns = st[c * NUM_SPACINGS + (size_t)s].median;
+            if (ns > 0) printf("\t%.2f", cycles(ns));
+            else printf("\t-");
+        }
+        printf("\n");
+    }
+    for (int s = 0; s < NUM_SPACINGS; s++) {
+        double base;
+        size_t k = knee(st + s, sw->ncounts, NUM_SPACINGS, &base);
+        printf("btb at %zu B spacing: ", spacings[s]);
+        if (k) {
+            printf("%zu branches fit, %zu don't (%.2f -> %.2f cycles)%s\n", sw->counts[k - 1],
+                   sw->counts[k], cycles(base), cycles(st[k * NUM_SPACINGS + (size_t)s].median),
+                   spacings[s] >= PAGE_SIZE ? ", about the ways of one set" : "");
+        } else {
+            printf("no penalty up to the largest count that fits in %zu MB\n", MAX_FOOTPRINT / MB);
+        }
+    }
+}
+
+static void run_rsb(branch_sweep_t *sw) {
+    sw->ncounts = 0;
+    for (size_t d = 1; d <= MAX_DEPTH; d++) sw->counts[sw->ncounts++] = d;
+    static stats_t st[MAX_POINTS];
+    point_ops_t ops = { rsb_setup, jit_trial, sw, rsb_label, "ns/call" };
+    measure_points(sw->ctx, sw->ncounts, &ops, st);
+
+    printf("\nReturn stack (cycles per call + ret)\n");
+    printf("Depth\tCycles\n");
+    printf("------------------------\n");
+    for (size_t d = 0; d < sw->ncounts; d++) {
+        printf("%zu\t%.2f\n", sw->counts[d], cycles(st[d].median));
+    }
+    // past the stack depth R only the outer D - R returns mispredict, so
+    // the cost per call climbs slowly; fit the extra cycles per pass,
+    // (c - base) D = P D - P R, over the depths past the knee for R and P
+    double base;
+    size_t k = knee(st, sw->ncounts, 1, &base);
+    if (!k || sw->ncounts - k < 2) {
+        printf("rsb: no penalty up to %d deep\n", MAX_DEPTH);
+        return;
+    }
+    double sx = 0, sy = 0, sxx = 0, sxy = 0, n = 0;
+    for (size_t d = k; d < sw->ncounts; d++) {
+        double x = (double)sw->counts[d];
+        double y = cycles(st[d].median - base) * x;
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+        n++;
+    }
+    double penalty = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+    double depth = -(sy - penalty * sx) / n / penalty;
+    if (penalty > 0 && depth > 0 && depth < MAX_DEPTH) {
+        printf("rsb: return stack ~%.0f entries, each return past it ~%.1f cycles\n", depth,
+               penalty);
+    } else {
+        printf("rsb: calls %zu deep return cleanly, %zu deep mispredict (%.2f -> %.2f cycles)\n",
+               sw->counts[k - 1], sw->counts[k], cycles(base), cycles(st[k].median));
+    }
+}
+
+// the longest period is the unpredictable baseline: half its branches
+// mispredict, so the gap to the short periods is half a penalty
+static void run_pht(branch_sweep_t *sw) {
+    sw->pattern = malloc(MAX_PERIOD);
+    if (!sw->pattern) {
+        perror("malloc");
+        return;
+    }
+    fill_counts(sw, 2, MAX_PERIOD, 1);
+    static stats_t st[MAX_POINTS];
+    point_ops_t ops = { pht_setup, jit_trial, sw, pht_label, "ns/branch" };
+    measure_points(sw->ctx, sw->ncounts, &ops, st);
+    free(sw->pattern);
+    sw->pattern = NULL;
+
+    double base;
+    knee(st, sw->ncounts, 1, &base);
+    double random = st[sw->ncounts - 1].median;
+    double gap = random - base;
+
+    printf("\nPattern history (cycles per branch, random pattern of each period)\n");
+    printf("Period\tCycles\tmispredicted\n");
+    printf("--------------------------------\n");
+    size_t learned = 0;
+    for (size_t p = 0; p < sw->ncounts; p++) {
+        double rate = gap > 0 ? 0.5 * (st[p].median - base) / gap : 0;
+        if (rate < 0) rate = 0;
+        if (rate < MISPREDICT_RATE && learned == p) learned = p + 1;
+        printf("%zu\t%.2f\t%.0f%%\n", sw->counts[p], cycles(st[p].median), 100 * rate);
+    }
+    if (cycles(gap) < 1) {
+        printf("pht: no mispredict cost seen, even at period %d\n", MAX_PERIOD);
+    } else if (learned) {
+        printf("pht: periods up to %zu are learned; mispredict ~%.1f cycles\n",
+               sw->counts[learned - 1], cycles(2 * gap));
+    } else {
+        printf("pht: even period %zu mispredicts; mispredict ~%.1f cycles\n", sw->counts[0],
+               cycles(2 * gap));
+    }
+}
+
+int probe_branch(probe_ctx_t *ctx, int argc, char **argv) {
+    const char *tests = "btb,rsb,pht";
+
+    static const struct option longopts[] = {
+        { "tests", required_argument, NULL, 't' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+        case 't': tests = optarg; break;
+        default:
+            fprintf(stderr, "Usage: memprobe branch [--tests=btb,rsb,pht]\n");
+            return 1;
+        }
+    }
+
+    static branch_sweep_t sw;
+    memset(&sw, 0, sizeof(sw));
+    sw.ctx = ctx;
+    if (jit_alloc(&sw.jit, MAX_FOOTPRINT) != 0) return 1;
+
+    printf("Branch Predictor Probe (cycles at %.2f GHz)\n", timer.core_ghz);
+    if (strstr(tests, "btb")) run_btb(&sw);
+    if (strstr(tests, "rsb")) run_rsb(&sw);
+    if (strstr(tests, "pht")) run_pht(&sw);
+
+    jit_free(&sw.jit);
+    return 0;
+}
@@ -0,0 +1,334 @@
+// probe_bw.c
+// bandwidth probe: streaming SIMD kernels (load, store, copy, triad, rmw)
+// swept over the same working-set sizes as the latency probes. kernels are
+// written once with GCC vector types and compiled per ISA through target
+// attributes, so sse2 / avx2 / avx512 are the same loop at 16 / 32 / 64 bytes.
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memprobe.h"
+
+#define MAX_SIZES 40
+#define UNROLL 4           // vectors per loop iteration, one per accumulator
+
+typedef void (*bw_kernel_fn)(char *dst, const char *a, const char *b,
+                             size_t bytes, size_t reps);
+
+static volatile uint64_t bw_sink;
+
+// ISA is the name suffix, TARGET the target attribute, W the vector width.
+// each array is bytes long and a multiple of UNROLL * W.
+#define DEFINE_BW_KERNELS(ISA, TARGET, W)                                        \
+    typedef uint64_t vu_##ISA __attribute__((vector_size(W)));                   \
+    typedef double vd_##ISA __attribute__((vector_size(W)));                     \
+                                                                                 \
+    TARGET static void bw_load_##ISA(char *dst, const char *a, const char *b,    \
+                                     size_t bytes, size_t reps) {                \
+        (void)dst; (void)b;                                                      \
+        const vu_##ISA *x = (const vu_##ISA *)a;                                 \
+        size_t n = bytes / W;                                                    \
+        vu_##ISA s0 = { 0 }, s1 = { 0 }, s2 = { 0 }, s3 = { 0 };                 \
+        for (size_t r = 0; r < reps; r++) {                                      \
+            for (size_t i = 0; i < n; i += UNROLL) {                             \
+                s0 ^= x[i]; s1 ^= x[i + 1]; s2 ^= x[i + 2]; s3 ^= x[i + 3];      \
+            }                                                                    \
+        }                                                                        \
+        s0 ^= s1 ^ s2 ^ s3;                                                      \
+        bw_sink = s0[0];                                                         \
+    }                                                                            \
+                                                                                 \
+    TARGET static void bw_store_##ISA(char *dst, const char *a, const char *b,   \
+                                      size_t bytes, size_t reps) {               \
+        (void)a; (void)b;                                                        \
+        vu_##ISA *y = (vu_##ISA *)dst;                                           \
+        size_t n = bytes / W;                                                    \
+        for (size_t r = 0; r < reps; r++) {                                      \
+            vu_##ISA v = (vu_##ISA){ 0 } + (r | 0x0101010100000000ULL);          \
+            for (size_t i = 0; i < n; i += UNROLL) {                             \
+                y[i] = v; y[i + 1] = v; y[i + 2] = v; y[i + 3] = v;              \
+            }                                                                    \
+            __asm__ volatile("" ::: "memory");                                   \
+        }                                                                        \
+    }                                                                            \
+                                                                                 \
+    TARGET static void bw_copy_##ISA(char *dst, const char *a, const char *b,    \
+                                     size_t bytes, size_t reps) {                \
+        (void)b;                                                                 \
+        vu_##ISA *y = (vu_##ISA *)dst;                                           \
+        const vu_##ISA *x = (const vu_##ISA *)a;                                 \
+        size_t n = bytes / W;                                                    \
+        for (size_t r = 0; r < reps; r++) {                                      \
+            for (size_t i = 0; i < n; i += UNROLL) {                             \
+                y[i] = x[i]; y[i + 1] = x[i + 1];                                \
+                y[i + 2] = x[i + 2]; y[i + 3] = x[i + 3];                        \
+            }                                                                    \
+            __asm__ volatile("" ::: "memory");                                   \
+        }                                                                        \
+    }                                                                            \
+                                                                                 \
+    TARGET static void bw_triad_##ISA(char *dst, const char *a, const char *b,   \
+                                      size_t bytes, size_t reps) {               \
+        vd_##ISA *y = (vd_##ISA *)dst;                                           \
+        const vd_##ISA *x = (const vd_##ISA *)a;                                 \
+        const vd_##ISA *z = (const vd_##ISA *)b;                                 \
+        vd_##ISA s = (vd_##ISA){ 0 } + 1.000001;                                 \
+        size_t n = bytes / W;                                                    \
+        for (size_t r = 0; r < reps; r++) {                                      \
+            for (size_t i = 0; i < n; i += UNROLL) {                             \
+                y[i] = x[i] + s * z[i];                                          \
+                y[i + 1] = x[i + 1] + s * z[i + 1];                              \
+                y[i + 2] = x[i + 2] + s * z[i + 2];                              \
+                y[i + 3] = x[i + 3] + s * z[i + 3];                              \
+            }                                                                    \
+            __asm__ volatile("" ::: "memory");                                   \
+        }                                                                        \
+    }                                                                            \
+                                                                                 \
+    TARGET static void bw_rmw_##ISA(char *dst, const char *a, const char *b,     \
+                                    size_t bytes, size_t reps) {                 \
+        (void)a; (void)b;                                                        \
+        vu_##ISA *y = (vu_##ISA *)dst;                                           \
+        size_t n = bytes / W;                                                    \
+        for (size_t r = 0; r < reps; r++) {                                      \
+            for (size_t i = 0; i < n; i += UNROLL) {                             \
+                y[i] += 1; y[i + 1] += 1; y[i + 2] += 1; y[i + 3] += 1;          \
+            }                                                                    \
+            __asm__ volatile("" ::: "memory");                                   \
+        }                                                                        \
+    }
+
+DEFINE_BW_KERNELS(sse2, __attribute__((target("sse2"))), 16)
+DEFINE_BW_KERNELS(avx2, __attribute__((target("avx2,fma"))), 32)
+DEFINE_BW_KERNELS(avx512, __attribute__((target("avx512f"))), 64)
+
+typedef struct {
+    const char *name;
+    int arrays;            // arrays the working set is split over
+    int moved;             // bytes of traffic per array byte (reads + writes)
+} bw_kind_t;
+
+enum { BW_LOAD, BW_STORE, BW_COPY, BW_TRIAD, BW_RMW, NUM_BW_KERNELS };
+
+static const bw_kind_t kinds[NUM_BW_KERNELS] = {
+    [BW_LOAD]  = { "load",  1, 1 },
+    [BW_STORE] = { "store", 1, 1 },
+    [BW_COPY]  = { "copy",  2, 2 },
+    [BW_TRIAD] = { "triad", 3, 3 },
+    [BW_RMW]   = { "rmw",   1, 2 },
+};
+
+typedef struct {
+    const char *name;
+    const char *feature;   // __builtin_cpu_supports name
+    size_t width;
+    bw_kernel_fn fn[NUM_BW_KERNELS];
+} bw_isa_t;
+
+static const bw_isa_t isas[] = {
+    { "sse2",   "sse2",    16, { bw_load_sse2, bw_store_sse2, bw_copy_sse2,
+                                 bw_triad_sse2, bw_rmw_sse2 } },
+    { "avx2",   "avx2",    32, { bw_load_avx2, bw_store_avx2, bw_copy_avx2,
+                                 bw_triad_avx2, bw_rmw_avx2 } },
+    { "avx512", "avx512f", 64, { bw_load_avx512, bw_store_avx512, bw_copy_avx512,
+                                 bw_triad_avx512, bw_rmw_avx512 } },
+    { NULL, NULL, 0, { NULL } }
+};
+
+static int isa_supported(const bw_isa_t *isa) {
+    __builtin_cpu_init();
+    if (strcmp(isa->feature, "sse2") == 0) return __builtin_cpu_supports("sse2");
+    if (strcmp(isa->feature, "avx2") == 0) return __builtin_cpu_supports("avx2");
+    if (strcmp(isa->feature, "avx512f") == 0) return __builtin_cpu_supports("avx512f");
+    return 0;
+}
+
+typedef struct {
+    probe_ctx_t *ctx;
+    const bw_isa_t *isa;
+    size_t ws[MAX_SIZES];
+    int nsizes;
+} bw_sweep_t;
+
+// points are size-major: point i is size i / NUM_BW_KERNELS, kernel i % NUM_BW_KERNELS
+static void bw_layout(bw_sweep_t *sw, size_t i, int *k, size_t *array_bytes,
+                      char **dst, char **a, char **b) {
+    size_t s = i / NUM_BW_KERNELS;
+    *k = (int)(i % NUM_BW_KERNELS);
+    size_t chunk = UNROLL * sw->isa->width;
+    *array_bytes = sw->ws[s] / kinds[*k].arrays / chunk * chunk;
+
+    // arrays back to back, each starting a line apart from a page boundary
+    // offset so they don't all alias in the same L1 sets
+    char *base = sw->ctx->arena.base;
+    size_t span = (*array_bytes + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE + CACHE_LINE_SIZE * 5;
+    *dst = base;
+    *a = kinds[*k].arrays > 1 ? base + span : base;
+    *b = kinds[*k].arrays > 2 ? base + 2 * span : base;
+}
+
+static void bw_label(void *arg, size_t i, char *buf, size_t len) {
+    const bw_sweep_t *sw = arg;
+    snprintf(buf, len, "%s %s %zu KB", sw->isa->name, kinds[i % NUM_BW_KERNELS].name,
+             sw->ws[i / NUM_BW_KERNELS] / KB);
+}
+
+static void bw_setup(void *arg, size_t i) {
+    bw_sweep_t *sw = arg;
+    int k;
+    size_t bytes;
+    char *dst, *a, *b;
+    bw_layout(sw, i, &k, &bytes, &dst, &a, &b);
+    sw->isa->fn[k](dst, a, b, bytes, 1); // pull the working set in
+}
+
+// ns per byte of traffic
+static double bw_trial(void *arg, size_t i) {
+    bw_sweep_t *sw = arg;
+    int k;
+    size_t bytes;
+    char *dst, *a, *b;
+    bw_layout(sw, i, &k, &bytes, &dst, &a, &b);
+
+    // same amount of traffic per trial at every size
+    size_t moved = bytes * kinds[k].moved;
+    size_t target = sw->ctx->opt.iterations * CACHE_LINE_SIZE;
+    size_t reps = target / moved ? target / moved : 1;
+
+    counters_begin();
+    uint64_t start = timer_start();
+    sw->isa->fn[k](dst, a, b, bytes, reps);
+    uint64_t end = timer_stop();
+    counters_end(reps * moved / CACHE_LINE_SIZE);
+
+    return timer_elapsed_ns(start, end, reps * moved);
+}
+
+// summary: typical GB/s of the rows that sit comfortably inside each level
+static void print_levels(bw_sweep_t *sw, const stats_t *st) {
+    static const int sysfs_index[] = { 0, 2, 3 };
+    static const char *names[] = { "L1", "L2", "L3", "DRAM" };
+    size_t lo = 0;
+
+    printf("\nLevel\tRange(KB)");
+    for (int k = 0; k < NUM_BW_KERNELS; k++) printf("\t%s", kinds[k].name);
+    printf("\n");
+
+    for (int l = 0; l < 4; l++) {
+        size_t hi;
+        if (l < 3) {
+            long cap = sysfs_cache_size(sw->ctx->opt.core, sysfs_index[l]);
+            if (cap <= 0) continue;
+            hi = (size_t)cap / 2;          // half the level, so it really fits
+        } else {
+            hi = SIZE_MAX;
+            lo *= 2;                       // twice the LLC, nothing left to hit
+        }
+
+        double best[NUM_BW_KERNELS] = { 0 };
+        int rows = 0;
+        for (int s = 0; s < sw->nsizes; s++) {
+            if (sw->ws[s] <= lo || sw->ws[s] > hi) continue;
+            rows++;
+            for (int k = 0; k < NUM_BW_KERNELS; k++) {
+                double gbs = 1.0 / st[s * NUM_BW_KERNELS + k].median;
+                if (gbs > best[k]) best[k] = gbs;
+            }
+        }
+        if (l < 3) lo = hi * 2;
+        if (!rows) continue;
+
+        printf("%s\t", names[l]);
+        if (l < 3) printf("<=%zu", hi / KB);
+        else printf(">%zu", lo / KB);
+        for (int k = 0; k < NUM_BW_KERNELS; k++) printf("\t%.1f", best[k]);
+        printf("\n");
+    }
+}
+
+static void run_isa(probe_ctx_t *ctx, bw_sweep_t *sw) {
+    size_t n = (size_t)sw->nsizes * NUM_BW_KERNELS;
+    stats_t *st = calloc(n, sizeof(stats_t));
+    if (!st) {
+        perror("calloc");
+        return;
+    }
+
+    point_ops_t ops = { bw_setup, bw_trial, sw, bw_label, "ns/byte" };
+    measure_points(ctx, n, &ops, st);
+
+    printf("\nISA: %s (GB/s, median)\n", sw->isa->name);
+    printf("Size(KB)");
+    for (int k = 0; k < NUM_BW_KERNELS; k++) printf("\t%s", kinds[k].name);
+    printf("\n------------------------------------------------------\n");
+    for (int s = 0; s < sw->nsizes; s++) {
+        printf("%zu\t", sw->ws[s] / KB);
+        for (int k = 0; k < NUM_BW_KERNELS; k++) {
+            printf("\t%.1f", 1.0 / st[s * NUM_BW_KERNELS + k].median);
+        }
+        printf("\n");
+    }
+    print_levels(sw, st);
+    free(st);
+}
+
+int probe_bw(probe_ctx_t *ctx, int argc, char **argv) {
+    size_t min_bytes = 4 * KB;
+    size_t max_bytes = 128 * MB;
+    const char *isa_name = "best";
+
+    static const struct option longopts[] = {
+        { "min", required_argument, NULL, 'm' },
+        { "max", required_argument, NULL, 'M' },
+        { "isa", required_argument, NULL, 'i' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+        case 'm': min_bytes = parse_size(optarg); break;
+        case 'M': max_bytes = parse_size(optarg); break;
+        case 'i': isa_name = optarg; break;
+        default:
+            fprintf(stderr, "Usage: memprobe bw [--min=SIZE] [--max=SIZE]"
+                            " [--isa=sse2|avx2|avx512|best|all]\n");
+            return 1;
+        }
+    }
+    // three arrays plus padding have to fit in the arena
+    if (max_bytes > ctx->arena.size / 2) max_bytes = ctx->arena.size / 2;
+    if (min_bytes < 4 * KB) min_bytes = 4 * KB;
+
+    static bw_sweep_t sw;
+    sw.ctx = ctx;
+    sw.nsizes = 0;
+    for (size_t b = min_bytes; b <= max_bytes && sw.nsizes < MAX_SIZES; b *= 2) {
+        sw.ws[sw.nsizes++] = b;
+    }
+
+    printf("Bandwidth Probe (load, store, copy, triad, rmw)\n");
+
+    const bw_isa_t *best = NULL;
+    int ran = 0;
+    for (int i = 0; isas[i].name; i++) {
+        if (!isa_supported(&isas[i])) continue;
+        best = &isas[i];
+        if (strcmp(isa_name, "all") == 0 || strcmp(isa_name, isas[i].name) == 0) {
+            sw.isa = &isas[i];
+            run_isa(ctx, &sw);
+            ran++;
+        }
+    }
+    if (strcmp(isa_name, "best") == 0 && best) {
+        sw.isa = best;
+        run_isa(ctx, &sw);
+        ran++;
+    }
+    if (!ran) {
+        fprintf(stderr, "bw: ISA '%s' not available here\n", isa_name);
+        return 1;
+    }
+    return 0;
+}
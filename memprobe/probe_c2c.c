@@ -0,0 +1,318 @@
+// probe_c2c.c
+// core-to-core latency: bounce one cache line between every pair of cores.
+// the main thread, pinned to a, writes an odd sequence number into a shared
+// flag; a responder pinned to b spins on it and answers with the next even
+// number. every round trip moves the line to b and back, so its time is two
+// coherence transfers. the summary sorts the pairs into latency classes
+// (SMT siblings, shared L2 cluster, same die, other socket...) and prints
+// which cores are connected within each class.
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memprobe.h"
+
+#define CLASS_JUMP 1.25    // gap between sorted pair latencies that starts a new class
+#define MAX_CLASSES 16
+#define C2C_STOP UINT64_MAX
+
+typedef struct {
+    volatile uint64_t *flag;
+    pthread_t tid;
+    int running;
+} responder_t;
+
+typedef struct {
+    probe_ctx_t *ctx;
+    int (*pairs)[2];
+    responder_t resp;
+    volatile uint64_t *flag;
+    uint64_t seq;
+    int failed;            // current pair couldn't be set up
+} c2c_sweep_t;
+
+static void *responder_main(void *arg) {
+    volatile uint64_t *flag = arg;
+    for (;;) {
+        uint64_t v = __atomic_load_n(flag, __ATOMIC_ACQUIRE);
+        if (v == C2C_STOP) break;
+        if (v & 1) __atomic_store_n(flag, v + 1, __ATOMIC_RELEASE);
+        else __builtin_ia32_pause();
+    }
+    return NULL;
+}
+
+static void responder_stop(c2c_sweep_t *sw) {
+    if (!sw->resp.running) return;
+    __atomic_store_n(sw->flag, C2C_STOP, __ATOMIC_RELEASE);
+    pthread_join(sw->resp.tid, NULL);
+    sw->resp.running = 0;
+}
+
+static int responder_start(c2c_sweep_t *sw, int cpu) {
+    *sw->flag = 0;
+    sw->seq = 0;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+    int err = pthread_create(&sw->resp.tid, &attr, responder_main, (void *)sw->flag);
+    pthread_attr_destroy(&attr);
+    if (err != 0) {
+        fprintf(stderr, "c2c: pthread_create: %s\n", strerror(err));
+        return -1;
+    }
+    sw->resp.running = 1;
+    return 0;
+}
+
+static size_t c2c_rounds(const c2c_sweep_t *sw) {
+    size_t rounds = sw->ctx->opt.iterations / 100;
+    return rounds < 100 ? 100 : rounds;
+}
+
+// round trips on the current pair; returns once the responder has answered
+static void ping(c2c_sweep_t *sw, size_t rounds) {
+    volatile uint64_t *flag = sw->flag;
+    uint64_t seq = sw->seq;
+    for (size_t r = 0; r < rounds; r++) {
+        seq += 2;
+        __atomic_store_n(flag, seq - 1, __ATOMIC_RELEASE);
+        while (__atomic_load_n(flag, __ATOMIC_ACQUIRE) != seq) __builtin_ia32_pause();
+    }
+    sw->seq = seq;
+}
+
+// point i is pair i: main on pairs[i][0], responder on pairs[i][1]. a pair
+// that can't be set up is marked failed and skipped.
+static void c2c_setup(void *arg, size_t i) {
+    c2c_sweep_t *sw = arg;
+    responder_stop(sw);
+    sw->failed = pin_to_core(sw->pairs[i][0]) != 0 ||
+                 responder_start(sw, sw->pairs[i][1]) != 0;
+    if (sw->failed) {
+        fprintf(stderr, "c2c: skipping %d->%d\n", sw->pairs[i][0], sw->pairs[i][1]);
+        return;
+    }
+    ping(sw, c2c_rounds(sw) / 10);
+}
+
+// ns per round trip
+static double c2c_trial(void *arg, size_t i) {
+    c2c_sweep_t *sw = arg;
+    (void)i;
+    if (sw->failed) return -1.0;
+    size_t rounds = c2c_rounds(sw);
+
+    counters_begin();
+    uint64_t start = timer_start();
+    ping(sw, rounds);
+    uint64_t end = timer_stop();
+    counters_end(rounds);
+
+    return timer_elapsed_ns(start, end, rounds);
+}
+
+static void c2c_label(void *arg, size_t i, char *buf, size_t len) {
+    const c2c_sweep_t *sw = arg;
+    snprintf(buf, len, "%d->%d", sw->pairs[i][0], sw->pairs[i][1]);
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int uf_find(int *parent, int x) {
+    while (parent[x] != x) x = parent[x] = parent[parent[x]];
+    return x;
+}
+
+int probe_c2c(probe_ctx_t *ctx, int argc, char **argv) {
+    cpumask_t cpus;
+    int have_cpus = 0;
+
+    static const struct option longopts[] = {
+        { "cpus", required_argument, NULL, 'C' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+        case 'C':
+            if (parse_cpu_list(optarg, &cpus) != 0) {
+                fprintf(stderr, "c2c: bad cpu list '%s'\n", optarg);
+                return 1;
+            }
+            have_cpus = 1;
+            break;
+        default:
+            fprintf(stderr, "Usage: memprobe c2c [--cpus=LIST]\n");
+            return 1;
+        }
+    }
+    if (!have_cpus && online_cpus(&cpus) != 0) {
+        fprintf(stderr, "c2c: can't read the online cpu list\n");
+        return 1;
+    }
+
+    static int list[MAX_CPUS];
+    int ncpus = 0;
+    for (int cpu = 0; cpu < MAX_CPUS && cpu < CPU_SETSIZE; cpu++) {
+        if (cpumask_test(&cpus, cpu)) list[ncpus++] = cpu;
+    }
+    char buf[256];
+    format_cpu_list(&cpus, buf, sizeof(buf));
+    printf("Core-to-Core Latency Probe (cpus %s, ns per round trip)\n", buf);
+    if (ncpus < 2) {
+        printf("need at least two cpus\n");
+        return 0;
+    }
+    // a cpu we can't run on would quietly measure some other pair
+    for (int a = 0; a < ncpus; a++) {
+        if (pin_to_core(list[a]) != 0) {
+            fprintf(stderr, "c2c: can't run on cpu %d\n", list[a]);
+            restore_affinity(&ctx->opt);
+            return 1;
+        }
+    }
+    restore_affinity(&ctx->opt);
+
+    size_t npairs = (size_t)ncpus * (ncpus - 1);
+    static c2c_sweep_t sw;
+    sw.ctx = ctx;
+    sw.flag = (volatile uint64_t *)ctx->arena.base;
+    sw.resp.running = 0;
+    sw.pairs = malloc(npairs * sizeof(*sw.pairs));
+    stats_t *st = calloc(npairs, sizeof(stats_t));
+    double *m = malloc((size_t)ncpus * ncpus * sizeof(double));
+    if (!sw.pairs || !st || !m) {
+        perror("malloc");
+        free(sw.pairs);
+        free(st);
+        free(m);
+        return 1;
+    }
+
+    size_t p = 0;
+    for (int a = 0; a < ncpus; a++) {
+        for (int b = 0; b < ncpus; b++) {
+            if (a == b) continue;
+            sw.pairs[p][0] = list[a];
+            sw.pairs[p][1] = list[b];
+            p++;
+        }
+    }
+
+    point_ops_t ops = { c2c_setup, c2c_trial, &sw, c2c_label, "ns/round trip" };
+    measure_points(ctx, npairs, &ops, st);
+    responder_stop(&sw);
+    restore_affinity(&ctx->opt);
+
+    p = 0;
+    for (int a = 0; a < ncpus; a++) {
+        for (int b = 0; b < ncpus; b++) {
+            if (a == b) {
+                m[a * ncpus + b] = 0.0;
+                continue;
+            }
+            // -1 marks a pair that was skipped
+            m[a * ncpus + b] = st[p].trials ? st[p].median : -1.0;
+            p++;
+        }
+    }
+
+    printf("from\\to");
+    for (int b = 0; b < ncpus; b++) printf("\t%d", list[b]);
+    printf("\n--------------------------------------------------------------------------------\n");
+    for (int a = 0; a < ncpus; a++) {
+        printf("%d", list[a]);
+        for (int b = 0; b < ncpus; b++) {
+            if (a == b || m[a * ncpus + b] < 0) printf("\t-");
+            else printf("\t%.0f", m[a * ncpus + b]);
+        }
+        printf("\n");
+    }
+
+    if (ctx->opt.verbose) {
+        printf("\n");
+        print_stats_header("Pair");
+        for (p = 0; p < npairs; p++) {
+            if (!st[p].trials) continue;
+            char label[32];
+            snprintf(label, sizeof(label), "%d->%d", sw.pairs[p][0], sw.pairs[p][1]);
+            print_stats_row(label, &st[p]);
+        }
+    }
+
+    // latency classes: split the sorted pair latencies (both directions
+    // averaged) wherever one is CLASS_JUMP above the previous
+    size_t nsym = (size_t)ncpus * (ncpus - 1) / 2;
+    double *sorted = malloc(nsym * sizeof(double));
+    int *parent = malloc(ncpus * sizeof(int));
+    if (!sorted || !parent) {
+        perror("malloc");
+    } else {
+        size_t k = 0;
+        for (int a = 0; a < ncpus; a++) {
+            for (int b = a + 1; b < ncpus; b++) {
+                if (m[a * ncpus + b] < 0 || m[b * ncpus + a] < 0) continue;
+                sorted[k++] = 0.5 * (m[a * ncpus + b] + m[b * ncpus + a]);
+            }
+        }
+        nsym = k;
+        qsort(sorted, nsym, sizeof(double), cmp_double);
+
+        double upper[MAX_CLASSES], lower[MAX_CLASSES];
+        int nclasses = 0;
+        for (k = 0; k < nsym; k++) {
+            if (nclasses == 0 ||
+                (sorted[k] > upper[nclasses - 1] * CLASS_JUMP && nclasses < MAX_CLASSES)) {
+                lower[nclasses] = sorted[k];
+                nclasses++;
+            }
+            upper[nclasses - 1] = sorted[k];
+        }
+
+        // class j groups: cores connected through pairs no slower than class j
+        printf("\nLatency classes (groups = cores linked by pairs at or below the class)\n");
+        for (int j = 0; j < nclasses; j++) {
+            for (int a = 0; a < ncpus; a++) parent[a] = a;
+            for (int a = 0; a < ncpus; a++) {
+                for (int b = a + 1; b < ncpus; b++) {
+                    if (m[a * ncpus + b] < 0 || m[b * ncpus + a] < 0) continue;
+                    double v = 0.5 * (m[a * ncpus + b] + m[b * ncpus + a]);
+                    if (v <= upper[j]) parent[uf_find(parent, a)] = uf_find(parent, b);
+                }
+            }
+
+            printf("%.0f-%.0f ns:", lower[j], upper[j]);
+            for (int a = 0; a < ncpus; a++) {
+                if (uf_find(parent, a) != a) continue;
+                cpumask_t g;
+                memset(&g, 0, sizeof(g));
+                for (int b = 0; b < ncpus; b++) {
+                    if (uf_find(parent, b) == a) cpumask_set(&g, list[b]);
+                }
+                format_cpu_list(&g, buf, sizeof(buf));
+                printf(" {%s}", buf);
+            }
+            printf("\n");
+        }
+    }
+
+    free(sorted);
+    free(parent);
+    free(sw.pairs);
+    free(st);
+    free(m);
+    return 0;
+}
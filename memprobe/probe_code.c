@@ -0,0 +1,201 @@
+// probe_code.c
+// code fetch probe: a JIT-built chain of taken jumps, one jump per block,
+// blocks a cache line or a page apart, visited in address order or in a
+// random order. time per jump against the code footprint steps up as the
+// chain falls out of the L1i, the L2 and the LLC (line spacing) and out of
+// the L1 iTLB and the STLB (page spacing). on the page curve each jump sits
+// at a rotating line offset so the pages don't all fight over one L1i set.
+// random order keeps the next-line and stream prefetchers from hiding the
+// misses; on very long chains the BTB runs out too, which adds a flat
+// resteer cost per jump rather than a step.
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memprobe.h"
+
+#define MIN_FOOTPRINT (1 * KB)
+#define MAX_POINTS 256
+#define STEP_RATIO 1.25            // rise over the previous size that counts as a step
+#define MAX_STEPS 4
+
+typedef enum {
+    LINE_SEQ,
+    LINE_RAND,
+    PAGE_SEQ,
+    PAGE_RAND,
+    NUM_VARIANTS
+} variant_t;
+
+static const char *const variant_names[NUM_VARIANTS] = {
+    "line seq", "line rand", "page seq", "page rand",
+};
+
+typedef struct {
+    probe_ctx_t *ctx;
+    jit_buf_t jit;
+    size_t sizes[MAX_POINTS];
+    size_t nsizes;
+    size_t blocks;             // jumps per pass of the current point
+    uint64_t reps;
+    jit_fn fn;
+    uint32_t *order;
+} code_sweep_t;
+
+static size_t block_offset(variant_t v, size_t b) {
+    if (v == LINE_SEQ || v == LINE_RAND) return b * CACHE_LINE_SIZE;
+    return b * PAGE_SIZE + b % (PAGE_SIZE / CACHE_LINE_SIZE) * CACHE_LINE_SIZE;
+}
+
+// point i: size i / NUM_VARIANTS, variant i % NUM_VARIANTS
+static void code_setup(void *arg, size_t i) {
+    code_sweep_t *sw = arg;
+    variant_t v = (variant_t)(i % NUM_VARIANTS);
+    size_t footprint = sw->sizes[i / NUM_VARIANTS];
+    size_t spacing = v == LINE_SEQ || v == LINE_RAND ? CACHE_LINE_SIZE : PAGE_SIZE;
+
+    sw->fn = NULL;
+    sw->blocks = footprint / spacing;
+    if (sw->blocks < 2) return;
+
+    for (size_t b = 0; b < sw->blocks; b++) sw->order[b] = (uint32_t)b;
+    if (v == LINE_RAND || v == PAGE_RAND) {
+        for (size_t b = sw->blocks - 1; b > 0; b--) {
+            size_t k = (size_t)(chain_rand() % (b + 1));
+            uint32_t temp = sw->order[b];
+            sw->order[b] = sw->order[k];
+            sw->order[k] = temp;
+        }
+    }
+
+    unsigned char *code = sw->jit.base;
+    for (size_t k = 0; k + 1 < sw->blocks; k++) {
+        jit_jmp(code + block_offset(v, sw->order[k]), code + block_offset(v, sw->order[k + 1]));
+    }
+    unsigned char *first = code + block_offset(v, sw->order[0]);
+    jit_loop_tail(code + block_offset(v, sw->order[sw->blocks - 1]), first);
+    jit_done(&sw->jit, block_offset(v, sw->blocks - 1) + CACHE_LINE_SIZE);
+
+    sw->reps = sw->ctx->opt.iterations / sw->blocks;
+    if (sw->reps == 0) sw->reps = 1;
+    sw->fn = (jit_fn)(void *)first;
+    sw->fn(sw->reps); // warm up
+}
+
+static void code_label(void *arg, size_t i, char *buf, size_t len) {
+    const code_sweep_t *sw = arg;
+    snprintf(buf, len, "%s %g KB", variant_names[i % NUM_VARIANTS],
+             (double)sw->sizes[i / NUM_VARIANTS] / KB);
+}
+
+// under two blocks there's no chain: skip the point
+static double code_trial(void *arg, size_t i) {
+    code_sweep_t *sw = arg;
+    (void)i;
+    if (!sw->fn) return -1.0;
+
+    counters_begin();
+    uint64_t start = timer_start();
+    sw->fn(sw->reps);
+    uint64_t end = timer_stop();
+    counters_end(sw->reps * sw->blocks);
+
+    return timer_elapsed_ns(start, end, sw->reps * sw->blocks);
+}
+
+int probe_code(probe_ctx_t *ctx, int argc, char **argv) {
+    size_t max_bytes = 64 * MB;
+
+    static const struct option longopts[] = {
+        { "max", required_argument, NULL, 'M' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+        case 'M': max_bytes = parse_size(optarg); break;
+        default:
+            fprintf(stderr, "Usage: memprobe code [--max=SIZE]\n");
+            return 1;
+        }
+    }
+    if (max_bytes < 4 * MIN_FOOTPRINT || max_bytes > 1024 * MB) {
+        fprintf(stderr, "code: --max must be 4K..1G\n");
+        return 1;
+    }
+
+    static code_sweep_t sw;
+    memset(&sw, 0, sizeof(sw));
+    sw.ctx = ctx;
+    // two sizes per octave: 1K, 1.5K, 2K, 3K, ...
+    for (size_t s = MIN_FOOTPRINT; s <= max_bytes && sw.nsizes + 2 <= MAX_POINTS / NUM_VARIANTS;
+         s *= 2) {
+        sw.sizes[sw.nsizes++] = s;
+        if (s + s / 2 <= max_bytes) sw.sizes[sw.nsizes++] = s + s / 2;
+    }
+    size_t top = sw.sizes[sw.nsizes - 1];
+    if (jit_alloc(&sw.jit, top + PAGE_SIZE) != 0) return 1;
+    sw.order = malloc(top / CACHE_LINE_SIZE * sizeof(uint32_t));
+    if (!sw.order) {
+        perror("malloc");
+        jit_free(&sw.jit);
+        return 1;
+    }
+
+    printf("Code Fetch Probe (ns per taken jump, one jump per line or per page)\n");
+
+    size_t n = sw.nsizes * NUM_VARIANTS;
+    static stats_t st[MAX_POINTS];
+    point_ops_t ops = { code_setup, code_trial, &sw, code_label, "ns/jump" };
+    measure_points(ctx, n, &ops, st);
+
+    if (ctx->opt.verbose) {
+        for (int v = 0; v < NUM_VARIANTS; v++) {
+            printf("\n%s\n", variant_names[v]);
+            print_stats_header("Code_Size(KB)");
+            for (size_t s = 0; s < sw.nsizes; s++) {
+                char label[32];
+                snprintf(label, sizeof(label), "%g", (double)sw.sizes[s] / KB);
+                print_stats_row(label, &st[s * NUM_VARIANTS + v]);
+            }
+        }
+        printf("\n");
+    }
+
+    printf("Code_Size(KB)");
+    for (int v = 0; v < NUM_VARIANTS; v++) printf("\t%s", variant_names[v]);
+    printf("\n------------------------------------------------------------\n");
+    for (size_t s = 0; s < sw.nsizes; s++) {
+        printf("%g\t", (double)sw.sizes[s] / KB);
+        for (int v = 0; v < NUM_VARIANTS; v++) {
+            double ns = st[s * NUM_VARIANTS + v].median;
+            if (ns > 0) printf("\t%.2f", ns);
+            else printf("\t-");
+        }
+        printf("\n");
+    }
+
+    // where each curve steps up
+    for (int v = 0; v < NUM_VARIANTS; v++) {
+        printf("%s steps:", variant_names[v]);
+        int steps = 0;
+        double prev = 0;
+        for (size_t s = 0; s < sw.nsizes && steps < MAX_STEPS; s++) {
+            double ns = st[s * NUM_VARIANTS + v].median;
+            if (ns <= 0) continue;
+            if (prev > 0 && ns > STEP_RATIO * prev) {
+                printf(" %g KB (%.2f -> %.2f ns)", (double)sw.sizes[s] / KB, prev, ns);
+                steps++;
+            }
+            prev = ns;
+        }
+        if (!steps) printf(" none");
+        printf("\n");
+    }
+
+    free(sw.order);
+    jit_free(&sw.jit);
+    return 0;
+}
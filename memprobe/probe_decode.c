@@ -0,0 +1,222 @@
+// probe_decode.c
+// decoder path probe: a JIT-built loop of NOPs of a given length mix and
+// footprint. small loops run out of the decoded-uop (op) cache and retire
+// at the rename width whatever the length; once the loop outgrows it, every
+// pass goes back through the legacy decoders, which are bound by fetch
+// bytes per cycle, so long instructions drop first and hardest. further
+// out the loop also leaves the L1i. instructions per cycle against the
+// footprint shows the op cache capacity (in bytes of this mix) and the
+// legacy decode bandwidth right after it.
+//
+// NOPs keep the back end out of it: they need no execution port, only
+// decode, rename and retire.
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memprobe.h"
+
+#define MIN_FOOTPRINT 256
+#define MAX_MIX 64
+#define MAX_CURVES 6
+#define MAX_POINTS 256
+#define DROP_RATIO 0.8             // IPC below this share of the small-loop IPC: fell out
+#define TAIL_BYTES 10              // jit_loop_tail()
+#define INSNS_PER_ITER 16          // NOPs retire several per ns, time more of them
+#define SMALL_POINTS 3             // sizes the small-loop IPC is taken over
+
+typedef struct {
+    char name[32];
+    int len[MAX_MIX];              // lengths emitted in turn
+    int n;
+    double avg;
+} mix_t;
+
+typedef struct {
+    probe_ctx_t *ctx;
+    jit_buf_t jit;
+    mix_t mixes[MAX_CURVES];
+    int nmixes;
+    size_t sizes[MAX_POINTS];
+    size_t nsizes;
+    size_t insns;              // instructions per pass of the current point
+    uint64_t reps;
+} decode_sweep_t;
+
+// "1:3,11" -> 1 1 1 11
+static int parse_mix(const char *s, mix_t *m) {
+    memset(m, 0, sizeof(*m));
+    snprintf(m->name, sizeof(m->name), "mix %s", s);
+    const char *p = s;
+    while (*p) {
+        char *end;
+        long len = strtol(p, &end, 10);
+        long weight = 1;
+        if (end == p || len < 1 || len > JIT_MAX_NOP) return -1;
+        p = end;
+        if (*p == ':') {
+            weight = strtol(p + 1, &end, 10);
+            if (end == p + 1 || weight < 1) return -1;
+            p = end;
+        }
+        for (long k = 0; k < weight; k++) {
+            if (m->n == MAX_MIX) return -1;
+            m->len[m->n++] = (int)len;
+        }
+        if (*p == ',') p++;
+        else if (*p) return -1;
+    }
+    if (m->n == 0) return -1;
+    for (int k = 0; k < m->n; k++) m->avg += m->len[k];
+    m->avg /= m->n;
+    return 0;
+}
+
+// point i: size i / nmixes, mix i % nmixes
+static void decode_setup(void *arg, size_t i) {
+    decode_sweep_t *sw = arg;
+    const mix_t *m = &sw->mixes[i % (size_t)sw->nmixes];
+    size_t footprint = sw->sizes[i / (size_t)sw->nmixes];
+
+    unsigned char *at = sw->jit.base, *end = sw->jit.base + footprint - TAIL_BYTES;
+    sw->insns = 0;
+    for (int k = 0; at < end; k = (k + 1) % m->n) {
+        int len = m->len[k];
+        if (len > end - at) len = (int)(end - at);
+        at = jit_nop(at, len);
+        sw->insns++;
+    }
+    at = jit_loop_tail(at, sw->jit.base);
+    jit_done(&sw->jit, (size_t)(at - sw->jit.base));
+    sw->insns += 2;            // dec, jnz
+
+    sw->reps = sw->ctx->opt.iterations * INSNS_PER_ITER / sw->insns;
+    if (sw->reps == 0) sw->reps = 1;
+    ((jit_fn)(void *)sw->jit.base)(sw->reps); // warm up
+}
+
+static void decode_label(void *arg, size_t i, char *buf, size_t len) {
+    const decode_sweep_t *sw = arg;
+    snprintf(buf, len, "%s %g KB", sw->mixes[i % (size_t)sw->nmixes].name,
+             (double)sw->sizes[i / (size_t)sw->nmixes] / KB);
+}
+
+static double decode_trial(void *arg, size_t i) {
+    decode_sweep_t *sw = arg;
+    jit_fn fn = (jit_fn)(void *)sw->jit.base;
+    (void)i;
+
+    counters_begin();
+    uint64_t start = timer_start();
+    fn(sw->reps);
+    uint64_t end = timer_stop();
+    counters_end(sw->reps * sw->insns);
+
+    return timer_elapsed_ns(start, end, sw->reps * sw->insns);
+}
+
+static double ipc(double ns) {
+    return ns > 0 ? 1.0 / (ns * timer.core_ghz) : 0;
+}
+
+int probe_decode(probe_ctx_t *ctx, int argc, char **argv) {
+    size_t max_bytes = 256 * KB;
+    const char *mix = NULL;
+
+    static const struct option longopts[] = {
+        { "max", required_argument, NULL, 'M' },
+        { "mix", required_argument, NULL, 'x' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+        case 'M': max_bytes = parse_size(optarg); break;
+        case 'x': mix = optarg; break;
+        default:
+            fprintf(stderr, "Usage: memprobe decode [--max=SIZE] [--mix=LEN[:WEIGHT],...]\n");
+            return 1;
+        }
+    }
+    if (max_bytes < 4 * MIN_FOOTPRINT || max_bytes > 64 * MB) {
+        fprintf(stderr, "decode: --max must be 1K..64M\n");
+        return 1;
+    }
+
+    static decode_sweep_t sw;
+    memset(&sw, 0, sizeof(sw));
+    sw.ctx = ctx;
+    if (mix) {
+        if (parse_mix(mix, &sw.mixes[0]) != 0) {
+            fprintf(stderr, "decode: --mix wants lengths 1..%d with optional :weight, "
+                            "at most %d in all\n", JIT_MAX_NOP, MAX_MIX);
+            return 1;
+        }
+        sw.nmixes = 1;
+    } else {
+        // pure lengths, then every length in turn
+        static const char *const defaults[] = { "1", "4", "8", "11",
+                                                "1,2,3,4,5,6,7,8,9,10,11" };
+        for (int k = 0; k < 5; k++) parse_mix(defaults[k], &sw.mixes[sw.nmixes++]);
+        for (int k = 0; k < 4; k++) {
+            snprintf(sw.mixes[k].name, sizeof(sw.mixes[k].name), "len %s", defaults[k]);
+        }
+        snprintf(sw.mixes[4].name, sizeof(sw.mixes[4].name), "len 1-11");
+    }
+
+    for (size_t s = MIN_FOOTPRINT; s <= max_bytes; s *= 2) {
+        if ((sw.nsizes + 2) * (size_t)sw.nmixes > MAX_POINTS) break;
+        sw.sizes[sw.nsizes++] = s;
+        if (s + s / 2 <= max_bytes) sw.sizes[sw.nsizes++] = s + s / 2;
+    }
+    if (jit_alloc(&sw.jit, sw.sizes[sw.nsizes - 1]) != 0) return 1;
+
+    printf("Decode Probe (NOP loops, instructions per cycle at %.2f GHz)\n", timer.core_ghz);
+
+    size_t n = sw.nsizes * (size_t)sw.nmixes;
+    static stats_t st[MAX_POINTS];
+    point_ops_t ops = { decode_setup, decode_trial, &sw, decode_label, "ns/insn" };
+    measure_points(ctx, n, &ops, st);
+
+    printf("Loop_Size(KB)");
+    for (int m = 0; m < sw.nmixes; m++) printf("\t%s", sw.mixes[m].name);
+    printf("\n------------------------------------------------------------------------\n");
+    for (size_t s = 0; s < sw.nsizes; s++) {
+        printf("%g\t", (double)sw.sizes[s] / KB);
+        for (int m = 0; m < sw.nmixes; m++) {
+            printf("\t%.2f", ipc(st[s * (size_t)sw.nmixes + (size_t)m].median));
+        }
+        printf("\n");
+    }
+
+    // op cache: first size where IPC drops well below the small loops; the
+    // legacy decode rate is the next point's, in bytes per cycle too
+    for (int m = 0; m < sw.nmixes; m++) {
+        const mix_t *mx = &sw.mixes[m];
+        double small = 0;
+        for (size_t s = 0; s < SMALL_POINTS && s < sw.nsizes; s++) {
+            double v = ipc(st[s * (size_t)sw.nmixes + (size_t)m].median);
+            if (v > small) small = v;
+        }
+        size_t drop = 0;
+        for (size_t s = 1; s < sw.nsizes && !drop; s++) {
+            if (ipc(st[s * (size_t)sw.nmixes + (size_t)m].median) < DROP_RATIO * small) drop = s;
+        }
+        printf("%s (avg %.1f B): small loops %.2f IPC", mx->name, mx->avg, small);
+        if (drop) {
+            double legacy = ipc(st[drop * (size_t)sw.nmixes + (size_t)m].median);
+            printf(", falls out of the op cache at %g KB (~%.0f instructions), "
+                   "then %.2f IPC = %.1f B/cycle\n",
+                   (double)sw.sizes[drop] / KB, (double)sw.sizes[drop] / mx->avg,
+                   legacy, legacy * mx->avg);
+        } else {
+            printf(", no drop up to %g KB (%.1f B/cycle)\n",
+                   (double)sw.sizes[sw.nsizes - 1] / KB, small * mx->avg);
+        }
+    }
+
+    jit_free(&sw.jit);
+    return 0;
+}
@@ -0,0 +1,332 @@
+// probe_evset.c
+// builds minimal LLC eviction sets out of same-offset lines by group testing
+// (evset.c), then asks pagemap where their members live. every member of a
+// set shares the target's set index, so the physical bits all members agree
+// on, counted up from the line offset, give the sets per slice. sets with
+// the same index that still don't evict each other's targets sit in
+// different slices. within one set every pair is same-slice, so the XOR of
+// their addresses is in the kernel of the slice hash; with the usual
+// XOR-of-address-bits hash the masks are what's orthogonal to all of those.
+// only bits above the set index are recovered: lines of one set never
+// differ below it.
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memprobe.h"
+
+#define DEFAULT_SETS 16
+#define MAX_SETS 256
+#define MAX_EV_WAYS 64
+#define BUILD_ATTEMPTS 3
+#define PHYS_BITS 52
+#define MIN_SPREAD 1.3         // memory / LLC reload below this: can't tell them apart
+
+typedef struct {
+    char *target;
+    char *lines[MAX_EV_WAYS];
+    size_t n;
+    size_t tests;              // eviction tests it took
+    size_t extra;              // later targets it also evicts
+    uint64_t index;            // physical set index of the target
+    uint64_t hash;             // recovered slice id
+} found_set_t;
+
+static uint64_t line_phys(const probe_ctx_t *ctx, const uint64_t *phys, const char *p) {
+    size_t page = (size_t)(p - ctx->arena.base) / PAGE_SIZE;
+    if (!phys[page]) return 0;
+    return phys[page] + (size_t)(p - ctx->arena.base) % PAGE_SIZE;
+}
+
+// number of low bits, from bit 0 up, on which every address agrees
+static int agree_bits(const uint64_t *addr, size_t n) {
+    uint64_t differ = 0;
+    for (size_t i = 1; i < n; i++) differ |= addr[i] ^ addr[0];
+    int b = 0;
+    while (b < PHYS_BITS && !((differ >> b) & 1)) b++;
+    return b;
+}
+
+static int parity(uint64_t x) {
+    return __builtin_parityll(x);
+}
+
+// null space of the XOR differences (one per row) restricted to bits
+// [lo, hi): masks m with parity(m & v) == 0 for every row v. returns how
+// many masks it wrote.
+static int null_space(uint64_t *rows, size_t nrows, int lo, int hi, uint64_t *masks) {
+    uint64_t keep = (hi >= 64 ? ~0ULL : (1ULL << hi) - 1) & ~((1ULL << lo) - 1);
+    int pivot_of[64];
+    size_t rank = 0;
+    for (int b = 0; b < 64; b++) pivot_of[b] = -1;
+
+    // reduced row echelon form
+    for (size_t i = 0; i < nrows; i++) rows[i] &= keep;
+    for (int b = lo; b < hi && rank < nrows; b++) {
+        size_t r = rank;
+        while (r < nrows && !((rows[r] >> b) & 1)) r++;
+        if (r == nrows) continue;
+        uint64_t temp = rows[r];
+        rows[r] = rows[rank];
+        rows[rank] = temp;
+        for (size_t i = 0; i < nrows; i++) {
+            if (i != rank && ((rows[i] >> b) & 1)) rows[i] ^= rows[rank];
+        }
+        pivot_of[b] = (int)rank++;
+    }
+
+    // one mask per free bit: that bit, plus every pivot whose row has it
+    int n = 0;
+    for (int f = lo; f < hi; f++) {
+        if (pivot_of[f] >= 0) continue;
+        uint64_t m = 1ULL << f;
+        for (int b = lo; b < hi; b++) {
+            if (pivot_of[b] >= 0 && ((rows[pivot_of[b]] >> f) & 1)) m |= 1ULL << b;
+        }
+        masks[n++] = m;
+    }
+    return n;
+}
+
+static void slice_report(probe_ctx_t *ctx, found_set_t *sets, size_t nsets,
+                         const uint64_t *phys, size_t ways) {
+    // where the set index ends: the fewest agreeing bits of any set, a
+    // random extra agreeing bit among ways + 1 addresses is unlikely
+    int top = PHYS_BITS;
+    uint64_t highest = 0;
+    for (size_t s = 0; s < nsets; s++) {
+        uint64_t addr[MAX_EV_WAYS + 1];
+        addr[0] = line_phys(ctx, phys, sets[s].target);
+        for (size_t i = 0; i < sets[s].n; i++) addr[i + 1] = line_phys(ctx, phys, sets[s].lines[i]);
+        for (size_t i = 0; i <= sets[s].n; i++) highest |= addr[i];
+        int bits = agree_bits(addr, sets[s].n + 1);
+        if (bits < top) top = bits;
+    }
+    for (size_t s = 0; s < nsets; s++) {
+        uint64_t addr = line_phys(ctx, phys, sets[s].target);
+        sets[s].index = (addr >> 6) & ((1ULL << (top - 6)) - 1);
+    }
+
+    if (top <= 12) {
+        printf("set index: members agree on no bit above the page offset%s\n",
+               under_hypervisor() ? " (pagemap is guest-physical here)" : "");
+        printf("slice hash: not recovered\n");
+        return;
+    }
+    int hi = 64 - __builtin_clzll(highest | 1);
+
+    long llc = sysfs_cache_size(ctx->opt.core, 3);
+    size_t per_slice = 1ULL << (top - 6);
+    printf("set index: physical bits 6..%d, %zu sets per slice (%zu KB span)\n",
+           top - 1, per_slice, per_slice * CACHE_LINE_SIZE / KB);
+
+    // same index, different set: different slices
+    size_t most = 0;
+    for (size_t s = 0; s < nsets; s++) {
+        size_t same = 0;
+        for (size_t t = 0; t < nsets; t++) same += sets[t].index == sets[s].index;
+        if (same > most) most = same;
+    }
+    if (llc > 0) {
+        size_t slices = (size_t)llc / (ways * per_slice * CACHE_LINE_SIZE);
+        printf("slices: %zu from sysfs size (%ld KB / %zu ways / %zu sets), "
+               "%zu seen on one index\n", slices, llc / (long)KB, ways, per_slice, most);
+    } else {
+        printf("slices: at least %zu seen on one index\n", most);
+    }
+
+    // same-slice differences within each set
+    size_t nrows = 0;
+    for (size_t s = 0; s < nsets; s++) nrows += sets[s].n;
+    uint64_t *rows = malloc((nrows + 1) * sizeof(uint64_t));
+    if (!rows) {
+        perror("malloc");
+        return;
+    }
+    nrows = 0;
+    for (size_t s = 0; s < nsets; s++) {
+        uint64_t t = line_phys(ctx, phys, sets[s].target);
+        for (size_t i = 0; i < sets[s].n; i++) rows[nrows++] = line_phys(ctx, phys, sets[s].lines[i]) ^ t;
+    }
+    uint64_t masks[64];
+    int nmasks = null_space(rows, nrows, top, hi, masks);
+    free(rows);
+
+    printf("slice hash over bits %d..%d: ", top, hi - 1);
+    if (nmasks == 0) {
+        printf("none, every bit varies within a slice\n");
+        return;
+    }
+    if (nmasks > 8) {
+        printf("%d candidate masks, too few sets to pin it down (try --sets)\n", nmasks);
+        return;
+    }
+    for (int m = 0; m < nmasks; m++) printf("%sbit%d = parity(pa & 0x%llx)", m ? ", " : "",
+                                            m, (unsigned long long)masks[m]);
+    printf("\n");
+
+    // check it: targets on the same index must hash apart
+    size_t clashes = 0, pairs = 0;
+    for (size_t s = 0; s < nsets; s++) {
+        uint64_t t = line_phys(ctx, phys, sets[s].target);
+        sets[s].hash = 0;
+        for (int m = 0; m < nmasks; m++) sets[s].hash |= (uint64_t)parity(t & masks[m]) << m;
+    }
+    for (size_t s = 0; s < nsets; s++) {
+        for (size_t t = s + 1; t < nsets; t++) {
+            if (sets[s].index != sets[t].index) continue;
+            pairs++;
+            clashes += sets[s].hash == sets[t].hash;
+        }
+    }
+    printf("check: %zu of %zu same-index set pairs hash to different slices\n",
+           pairs - clashes, pairs);
+
+    printf("\nSet\tIndex\tSlice\tAlso evicts\n");
+    for (size_t s = 0; s < nsets; s++) {
+        printf("%zu\t0x%llx\t%llu\t%zu\n", s, (unsigned long long)sets[s].index,
+               (unsigned long long)sets[s].hash, sets[s].extra);
+    }
+}
+
+int probe_evset(probe_ctx_t *ctx, int argc, char **argv) {
+    size_t want = DEFAULT_SETS;
+    size_t offset = 0;
+    size_t pool = 0;
+    long ways = 0;
+
+    static const struct option longopts[] = {
+        { "sets",   required_argument, NULL, 'n' },
+        { "offset", required_argument, NULL, 'o' },
+        { "pool",   required_argument, NULL, 'P' },
+        { "ways",   required_argument, NULL, 'w' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+        case 'n': want = parse_size(optarg); break;
+        case 'o': offset = parse_size(optarg); break;
+        case 'P': pool = parse_size(optarg); break;
+        case 'w': ways = atol(optarg); break;
+        default:
+            fprintf(stderr, "Usage: memprobe evset [--sets=N] [--offset=BYTES] "
+                            "[--pool=LINES] [--ways=N]\n");
+            return 1;
+        }
+    }
+    if (ways == 0) ways = sysfs_cache_value(ctx->opt.core, 3, "ways_of_associativity");
+    if (ways <= 0) ways = 16;
+    if (ways > MAX_EV_WAYS || want == 0 || want > MAX_SETS) {
+        fprintf(stderr, "evset: --ways must be 1..%d, --sets 1..%d\n", MAX_EV_WAYS, MAX_SETS);
+        return 1;
+    }
+    offset = offset % PAGE_SIZE / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+
+    // same-offset lines fall into llc / (ways * PAGE_SIZE) (slice, set)
+    // classes; start at twice the ways per class and double until the pool
+    // evicts (non-inclusive and adaptive LLCs want more)
+    long llc = sysfs_cache_size(ctx->opt.core, 3);
+    size_t classes = (llc > 0 ? (size_t)llc : 32 * MB) / ((size_t)ways * PAGE_SIZE);
+    size_t start = pool ? pool : 2 * (size_t)ways * (classes ? classes : 1);
+
+    evset_ctx_t ev;
+    if (evset_init(&ev, ctx, offset, pool ? pool : ctx->arena.size / PAGE_SIZE, (size_t)ways) != 0)
+        return 1;
+    printf("Eviction Set Probe (%ld ways, page offset %zu)\n", ways, offset);
+
+    // redo the quick calibration from evset_init to full trials, so the
+    // reloads are recorded and the threshold sits between two solid medians
+    stats_t hit, miss;
+    measure_point(&ctx->opt, evset_reload_trial, &ev, 0, "llc reload", &hit);
+    measure_point(&ctx->opt, evset_reload_trial, &ev, 1, "memory reload", &miss);
+    evset_calibrate(&ev, hit.median, miss.median);
+    printf("reload: LLC %.1f ns, memory %.1f ns, threshold %.1f ns\n",
+           ev.hit_ns, ev.miss_ns, ev.threshold);
+    if (ev.miss_ns < MIN_SPREAD * ev.hit_ns) {
+        fprintf(stderr, "evset: LLC and memory reloads too close to tell apart\n");
+        evset_free(&ev);
+        return 1;
+    }
+    if (evset_fit_pool(&ev, start) == 0) {
+        fprintf(stderr, "evset: %zu lines don't evict a target, try a bigger --arena\n",
+                ev.npool);
+        evset_free(&ev);
+        return 1;
+    }
+
+    printf("pool: %zu candidate lines, sysfs size predicts %zu would evict\n",
+           ev.npool, (size_t)ways * classes);
+
+    static found_set_t sets[MAX_SETS];
+    char **work = malloc(ev.npool * sizeof(char *));
+    size_t *order = malloc(ev.npool * sizeof(size_t));
+    uint64_t *phys = malloc(ev.npool * sizeof(uint64_t));
+    if (!work || !order || !phys) {
+        perror("malloc");
+        free(work);
+        free(order);
+        free(phys);
+        evset_free(&ev);
+        return 1;
+    }
+    for (size_t i = 0; i < ev.npool; i++) order[i] = i;
+    for (size_t i = ev.npool - 1; i > 0; i--) {
+        size_t k = (size_t)(chain_rand() % (i + 1));
+        size_t temp = order[i];
+        order[i] = order[k];
+        order[k] = temp;
+    }
+
+    printf("Set\tTarget\t\tLines\tTests\n");
+    printf("------------------------------------------\n");
+    size_t nsets = 0, failed = 0;
+    for (size_t i = 0; i < ev.npool && nsets < want && failed < want; i++) {
+        char *target = ev.pool[order[i]];
+        // a target some set already evicts is congruent with that set
+        int known = 0;
+        for (size_t s = 0; s < nsets && !known; s++) {
+            if (evset_evicts(&ev, target, sets[s].lines, sets[s].n)) {
+                sets[s].extra++;
+                known = 1;
+            }
+        }
+        if (known) continue;
+
+        size_t before = ev.tests;
+        size_t n = evset_build(&ev, target, work, BUILD_ATTEMPTS);
+        if (n == 0 || n > MAX_EV_WAYS) {
+            failed++;
+            continue;
+        }
+        found_set_t *fs = &sets[nsets++];
+        fs->target = target;
+        fs->n = n;
+        fs->tests = ev.tests - before;
+        memcpy(fs->lines, work, n * sizeof(char *));
+        printf("%zu\t%p\t%zu\t%zu\n", nsets - 1, (void *)target, n, fs->tests);
+        fflush(stdout);
+    }
+    printf("built %zu minimal sets, %zu targets failed to reduce, %zu eviction tests\n",
+           nsets, failed, ev.tests);
+    if (nsets == 0 && failed > 0) {
+        printf("no set reduces to %ld lines: eviction here follows volume, not set index%s\n",
+               ways, under_hypervisor() ? " (shared host LLC?)" : "");
+    }
+
+    if (nsets > 0) {
+        if (pagemap_phys(ctx->arena.base, ev.npool, phys) == ev.npool) {
+            slice_report(ctx, sets, nsets, phys, (size_t)ways);
+        } else {
+            printf("slice hash: needs pagemap frame numbers (run as root)\n");
+        }
+    }
+
+    free(work);
+    free(order);
+    free(phys);
+    evset_free(&ev);
+    return 0;
+}
@@ -0,0 +1,113 @@
+// probe_icache.c
+// instruction cache probe: run a NOP sled of growing size and time each call.
+// code lives in its own executable mapping, not the data arena.
+#include <getopt.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "memprobe.h"
+
+// throw empty instructions
+// NOP is no operations
+#define NOP 0x90
+#define RET 0xC3
+
+#define MAX_SLEDS 1024
+
+typedef struct {
+    unsigned char *code;
+    size_t step;
+    size_t calls;
+} icache_sweep_t;
+
+static void icache_setup(void *arg, size_t i) {
+    icache_sweep_t *sw = arg;
+    size_t size = (i + 1) * sw->step;
+
+    // fill it up with NOPs, last instr is a return statement
+    memset(sw->code, NOP, size);
+    sw->code[size - 1] = RET;
+    __builtin___clear_cache((char *)sw->code, (char *)sw->code + size);
+
+    void (*func_ptr)(void) = (void (*)(void))sw->code;
+    func_ptr(); // warm up
+}
+
+static void icache_label(void *arg, size_t i, char *buf, size_t len) {
+    const icache_sweep_t *sw = arg;
+    snprintf(buf, len, "sled %zu B", (i + 1) * sw->step);
+}
+
+static double icache_trial(void *arg, size_t i) {
+    icache_sweep_t *sw = arg;
+    void (*func_ptr)(void) = (void (*)(void))sw->code;
+    (void)i;
+
+    counters_begin();
+    uint64_t start = timer_start();
+    for (size_t k = 0; k < sw->calls; k++) {
+        func_ptr();
+    }
+    uint64_t end = timer_stop();
+    counters_end(sw->calls);
+
+    return timer_elapsed_ns(start, end, sw->calls);
+}
+
+int probe_icache(probe_ctx_t *ctx, int argc, char **argv) {
+    size_t max_bytes = 128 * KB;
+    size_t step = 2 * KB;
+
+    static const struct option longopts[] = {
+        { "max",  required_argument, NULL, 'M' },
+        { "step", required_argument, NULL, 's' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+        case 'M': max_bytes = parse_size(optarg); break;
+        case 's': step = parse_size(optarg); break;
+        default:
+            fprintf(stderr, "Usage: memprobe icache [--max=SIZE] [--step=SIZE]\n");
+            return 1;
+        }
+    }
+    if (step == 0 || max_bytes < step || max_bytes / step > MAX_SLEDS) {
+        fprintf(stderr, "icache: bad --max/--step (at most %d sleds)\n", MAX_SLEDS);
+        return 1;
+    }
+
+    // one mapping sized for the biggest sled, reused for every size
+    unsigned char *code = mmap(NULL, max_bytes,
+                               PROT_READ | PROT_WRITE | PROT_EXEC,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+        perror("mmap code");
+        return 1;
+    }
+
+    printf("I-Cache Probe (Code Size vs Time per Call)\n");
+
+    // sleds are long, so far fewer calls than data accesses are needed
+    icache_sweep_t sw = { .code = code, .step = step };
+    sw.calls = ctx->opt.iterations / 500;
+    if (sw.calls < 100) sw.calls = 100;
+
+    size_t n = max_bytes / step;
+    point_ops_t ops = { icache_setup, icache_trial, &sw, icache_label, "ns/call" };
+    static stats_t st[MAX_SLEDS];
+    measure_points(ctx, n, &ops, st);
+
+    print_stats_header("Code_Size(KB)");
+    for (size_t i = 0; i < n; i++) {
+        char label[32];
+        snprintf(label, sizeof(label), "%zu", (i + 1) * step / KB);
+        print_stats_row(label, &st[i]);
+    }
+
+    munmap(code, max_bytes);
+    return 0;
+}
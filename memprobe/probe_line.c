@@ -0,0 +1,68 @@
+// probe_line.c
+// cache line probe: strided chase over a region bigger than every cache.
+// time per hop keeps rising with the stride until the stride reaches the
+// line size, after which every hop is a fresh line anyway and it flattens.
+#include <getopt.h>
+#include <stdio.h>
+
+#include "memprobe.h"
+
+#define NUM_STRIDES 6
+
+typedef struct {
+    chase_point_t cp;
+    size_t region;
+} line_sweep_t;
+
+// Test strides from 16 up to 512
+static size_t stride_of(size_t i) {
+    return (size_t)16 << i;
+}
+
+static void line_setup(void *arg, size_t i) {
+    line_sweep_t *sw = arg;
+    size_t stride = stride_of(i);
+    sw->cp.head = chain_strided(sw->cp.ctx->arena.base, sw->region / stride, stride);
+    sw->cp.head = chase(sw->cp.head, 1000);
+}
+
+static void line_label(void *arg, size_t i, char *buf, size_t len) {
+    (void)arg;
+    snprintf(buf, len, "stride %zu B", stride_of(i));
+}
+
+int probe_line(probe_ctx_t *ctx, int argc, char **argv) {
+    size_t region = 64 * MB;
+
+    static const struct option longopts[] = {
+        { "region", required_argument, NULL, 'r' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+        case 'r': region = parse_size(optarg); break;
+        default:
+            fprintf(stderr, "Usage: memprobe line [--region=SIZE]\n");
+            return 1;
+        }
+    }
+    if (region > ctx->arena.size) region = ctx->arena.size;
+
+    printf("Cache Line Probe (Region = %zu KB)\n", region / KB);
+
+    line_sweep_t sw = { .cp = { ctx, NULL }, .region = region };
+    point_ops_t ops = { line_setup, chase_trial, &sw, line_label };
+    stats_t st[NUM_STRIDES];
+    measure_points(ctx, NUM_STRIDES, &ops, st);
+
+    print_stats_header("Stride(B)");
+    for (size_t i = 0; i < NUM_STRIDES; i++) {
+        char label[32];
+        snprintf(label, sizeof(label), "%zu", stride_of(i));
+        print_stats_row(label, &st[i]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,180 @@
+// probe_mlp.c
+// memory-level parallelism probe: chase K independent chains in one loop.
+// with one chain every miss waits for the last; with K chains up to K
+// misses can be in flight, until the core runs out of fill buffers / MSHRs.
+// by Little's law the effective number of outstanding misses at each K is
+// latency(K=1) / time per access(K), and it levels off at the hardware limit.
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "memprobe.h"
+
+#define MAX_K 32
+#define CHECKPOINTS 1024   // positions remembered along the cycle for heads
+
+// K values shown as columns of the summary, the rest go to --verbose
+static const int shown_k[] = { 1, 2, 4, 8, 12, 16, 24, 32, 0 };
+
+// one kernel per K so the K pointers live in registers (past ~14 chains
+// some get spilled, which adds an L1 hit per hop but no dependency chain)
+#define DEFINE_CHASE_K(K)                                                 \
+    __attribute__((noinline))                                             \
+    static void chase_##K(void ***heads, size_t steps) {                  \
+        void **q[K];                                                      \
+        for (int j = 0; j < K; j++) q[j] = heads[j];                      \
+        for (size_t s = 0; s < steps; s++) {                              \
+            _Pragma("GCC unroll 32")                                      \
+            for (int j = 0; j < K; j++) q[j] = (void**)*q[j];             \
+        }                                                                 \
+        for (int j = 0; j < K; j++) heads[j] = q[j];                      \
+    }
+
+DEFINE_CHASE_K(1)  DEFINE_CHASE_K(2)  DEFINE_CHASE_K(3)  DEFINE_CHASE_K(4)
+DEFINE_CHASE_K(5)  DEFINE_CHASE_K(6)  DEFINE_CHASE_K(7)  DEFINE_CHASE_K(8)
+DEFINE_CHASE_K(9)  DEFINE_CHASE_K(10) DEFINE_CHASE_K(11) DEFINE_CHASE_K(12)
+DEFINE_CHASE_K(13) DEFINE_CHASE_K(14) DEFINE_CHASE_K(15) DEFINE_CHASE_K(16)
+DEFINE_CHASE_K(17) DEFINE_CHASE_K(18) DEFINE_CHASE_K(19) DEFINE_CHASE_K(20)
+DEFINE_CHASE_K(21) DEFINE_CHASE_K(22) DEFINE_CHASE_K(23) DEFINE_CHASE_K(24)
+DEFINE_CHASE_K(25) DEFINE_CHASE_K(26) DEFINE_CHASE_K(27) DEFINE_CHASE_K(28)
+DEFINE_CHASE_K(29) DEFINE_CHASE_K(30) DEFINE_CHASE_K(31) DEFINE_CHASE_K(32)
+
+static void (*const chase_k[MAX_K + 1])(void ***, size_t) = {
+    NULL,
+    chase_1,  chase_2,  chase_3,  chase_4,  chase_5,  chase_6,  chase_7,  chase_8,
+    chase_9,  chase_10, chase_11, chase_12, chase_13, chase_14, chase_15, chase_16,
+    chase_17, chase_18, chase_19, chase_20, chase_21, chase_22, chase_23, chase_24,
+    chase_25, chase_26, chase_27, chase_28, chase_29, chase_30, chase_31, chase_32,
+};
+
+typedef struct {
+    probe_ctx_t *ctx;
+    size_t bytes;              // working set of the current cycle
+    void **checkpoint[CHECKPOINTS];
+    int ncheck;
+    void **heads[MAX_K];
+} mlp_sweep_t;
+
+// one random cycle over the whole working set; remember evenly spaced
+// points along it so any K can pick K heads that split it into K segments.
+// chains advance in lockstep, so they never run into each other.
+static int mlp_build(mlp_sweep_t *sw, size_t bytes) {
+    size_t n = bytes / CACHE_LINE_SIZE;
+    void **p = chain_random(sw->ctx->arena.base, bytes, CACHE_LINE_SIZE);
+    if (!p) return -1;
+
+    sw->bytes = bytes;
+    sw->ncheck = n < CHECKPOINTS ? (int)n : CHECKPOINTS;
+    size_t gap = n / sw->ncheck;
+    for (int c = 0; c < sw->ncheck; c++) {
+        sw->checkpoint[c] = p;
+        p = chase(p, gap);
+    }
+    return 0;
+}
+
+// point i runs K = i + 1 chains
+static void mlp_setup(void *arg, size_t i) {
+    mlp_sweep_t *sw = arg;
+    int k = (int)i + 1;
+    for (int j = 0; j < k; j++) {
+        sw->heads[j] = sw->checkpoint[(size_t)j * sw->ncheck / k];
+    }
+    chase_k[k](sw->heads, 1000);
+}
+
+static void mlp_label(void *arg, size_t i, char *buf, size_t len) {
+    const mlp_sweep_t *sw = arg;
+    snprintf(buf, len, "%zu KB K=%zu", sw->bytes / KB, i + 1);
+}
+
+// ns per access, with the same total access count at every K
+static double mlp_trial(void *arg, size_t i) {
+    mlp_sweep_t *sw = arg;
+    int k = (int)i + 1;
+    size_t steps = sw->ctx->opt.iterations / k;
+    if (steps == 0) steps = 1;
+
+    counters_begin();
+    uint64_t start = timer_start();
+    chase_k[k](sw->heads, steps);
+    uint64_t end = timer_stop();
+    counters_end(steps * k);
+
+    return timer_elapsed_ns(start, end, steps * k);
+}
+
+int probe_mlp(probe_ctx_t *ctx, int argc, char **argv) {
+    size_t min_bytes = 16 * KB;
+    size_t max_bytes = 64 * MB;
+    int max_k = MAX_K;
+
+    static const struct option longopts[] = {
+        { "min",   required_argument, NULL, 'm' },
+        { "max",   required_argument, NULL, 'M' },
+        { "max-k", required_argument, NULL, 'k' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+        case 'm': min_bytes = parse_size(optarg); break;
+        case 'M': max_bytes = parse_size(optarg); break;
+        case 'k': max_k = atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: memprobe mlp [--min=SIZE] [--max=SIZE] [--max-k=N]\n");
+            return 1;
+        }
+    }
+    if (max_bytes > ctx->arena.size) max_bytes = ctx->arena.size;
+    // every chain needs its own checkpoint to start from
+    if (max_k < 1 || max_k > MAX_K || min_bytes < (size_t)CACHE_LINE_SIZE * max_k) {
+        fprintf(stderr, "mlp: --max-k must be 1..%d, --min at least one line per chain\n",
+                MAX_K);
+        return 1;
+    }
+
+    printf("Memory-Level Parallelism Probe (1..%d Independent Chains)\n", max_k);
+
+    static mlp_sweep_t sw;
+    sw.ctx = ctx;
+    point_ops_t ops = { mlp_setup, mlp_trial, &sw, mlp_label };
+    stats_t st[MAX_K];
+
+    // effective outstanding misses at K = latency(1) / time per access(K)
+    printf("Effective MLP at K chains\n");
+    printf("Size(KB)");
+    for (int j = 0; shown_k[j] && shown_k[j] <= max_k; j++) printf("\tK=%d", shown_k[j]);
+    printf("\t| Peak\tBest_K\tns/acc(K=1)\tGB/s(best)\n");
+    printf("----------------------------------------------------------------------------"
+           "------------------------\n");
+
+    for (size_t bytes = min_bytes; bytes <= max_bytes; bytes *= 2) {
+        if (mlp_build(&sw, bytes) != 0) break;
+        measure_points(ctx, max_k, &ops, st);
+
+        int best = 0;
+        for (int i = 1; i < max_k; i++) {
+            if (st[i].median < st[best].median) best = i;
+        }
+        printf("%zu\t", bytes / KB);
+        for (int j = 0; shown_k[j] && shown_k[j] <= max_k; j++) {
+            printf("\t%.1f", st[0].median / st[shown_k[j] - 1].median);
+        }
+        printf("\t| %.1f\t%d\t%.3f\t\t%.2f\n", st[0].median / st[best].median,
+               best + 1, st[0].median, CACHE_LINE_SIZE / st[best].median);
+
+        if (ctx->opt.verbose) {
+            print_stats_header("  K");
+            for (int i = 0; i < max_k; i++) {
+                char label[32];
+                snprintf(label, sizeof(label), "  %d", i + 1);
+                print_stats_row(label, &st[i]);
+            }
+            printf("\n");
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,279 @@
+// probe_nt.c
+// streaming store probe: regular stores vs non-temporal stores (movntdq,
+// movnti) vs rep stosb / rep movsb, from L2-sized buffers to many times the
+// LLC. NT stores skip the read-for-ownership and don't pollute the cache,
+// which pays off once the buffer can't stay cached anyway; below that they
+// cost a trip to DRAM when the data is read back. the read-after column
+// times exactly that read back, and the crossover lines say from which
+// size streaming wins on this host.
+#include <getopt.h>
+#include <immintrin.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "memprobe.h"
+
+#define MAX_SIZES 24
+
+typedef enum { NT_STORE, NT_STREAM, NT_MOVNTI, NT_STOSB,
+               NT_COPY, NT_COPY_STREAM, NT_MOVSB, NUM_NT_METHODS } nt_method_t;
+
+static const char *method_names[NUM_NT_METHODS] = {
+    "store", "movntdq", "movnti", "stosb", "copy", "copy_nt", "movsb",
+};
+
+static volatile uint64_t nt_sink;
+
+static void store_regular(char *dst, const char *src, size_t n) {
+    (void)src;
+    __m128i v = _mm_set1_epi32(0x5a5a0101);
+    for (size_t i = 0; i < n; i += 64) {
+        _mm_store_si128((__m128i *)(dst + i), v);
+        _mm_store_si128((__m128i *)(dst + i + 16), v);
+        _mm_store_si128((__m128i *)(dst + i + 32), v);
+        _mm_store_si128((__m128i *)(dst + i + 48), v);
+    }
+}
+
+static void store_stream(char *dst, const char *src, size_t n) {
+    (void)src;
+    __m128i v = _mm_set1_epi32(0x5a5a0101);
+    for (size_t i = 0; i < n; i += 64) {
+        _mm_stream_si128((__m128i *)(dst + i), v);
+        _mm_stream_si128((__m128i *)(dst + i + 16), v);
+        _mm_stream_si128((__m128i *)(dst + i + 32), v);
+        _mm_stream_si128((__m128i *)(dst + i + 48), v);
+    }
+    _mm_sfence();
+}
+
+static void store_movnti(char *dst, const char *src, size_t n) {
+    (void)src;
+    for (size_t i = 0; i < n; i += 8) {
+        _mm_stream_si64((long long *)(dst + i), 0x5a5a01015a5a0101LL);
+    }
+    _mm_sfence();
+}
+
+static void store_stosb(char *dst, const char *src, size_t n) {
+    (void)src;
+    __asm__ volatile("rep stosb" : "+D"(dst), "+c"(n) : "a"(0x5a) : "memory");
+}
+
+static void copy_regular(char *dst, const char *src, size_t n) {
+    for (size_t i = 0; i < n; i += 64) {
+        __m128i a = _mm_load_si128((const __m128i *)(src + i));
+        __m128i b = _mm_load_si128((const __m128i *)(src + i + 16));
+        __m128i c = _mm_load_si128((const __m128i *)(src + i + 32));
+        __m128i d = _mm_load_si128((const __m128i *)(src + i + 48));
+        _mm_store_si128((__m128i *)(dst + i), a);
+        _mm_store_si128((__m128i *)(dst + i + 16), b);
+        _mm_store_si128((__m128i *)(dst + i + 32), c);
+        _mm_store_si128((__m128i *)(dst + i + 48), d);
+    }
+}
+
+static void copy_stream(char *dst, const char *src, size_t n) {
+    for (size_t i = 0; i < n; i += 64) {
+        __m128i a = _mm_load_si128((const __m128i *)(src + i));
+        __m128i b = _mm_load_si128((const __m128i *)(src + i + 16));
+        __m128i c = _mm_load_si128((const __m128i *)(src + i + 32));
+        __m128i d = _mm_load_si128((const __m128i *)(src + i + 48));
+        _mm_stream_si128((__m128i *)(dst + i), a);
+        _mm_stream_si128((__m128i *)(dst + i + 16), b);
+        _mm_stream_si128((__m128i *)(dst + i + 32), c);
+        _mm_stream_si128((__m128i *)(dst + i + 48), d);
+    }
+    _mm_sfence();
+}
+
+static void copy_movsb(char *dst, const char *src, size_t n) {
+    __asm__ volatile("rep movsb" : "+D"(dst), "+S"(src), "+c"(n) : : "memory");
+}
+
+static void (*const methods[NUM_NT_METHODS])(char *, const char *, size_t) = {
+    store_regular, store_stream, store_movnti, store_stosb,
+    copy_regular, copy_stream, copy_movsb,
+};
+
+static void read_back(const char *src, size_t n) {
+    __m128i s0 = _mm_setzero_si128(), s1 = s0, s2 = s0, s3 = s0;
+    for (size_t i = 0; i < n; i += 64) {
+        s0 = _mm_xor_si128(s0, _mm_load_si128((const __m128i *)(src + i)));
+        s1 = _mm_xor_si128(s1, _mm_load_si128((const __m128i *)(src + i + 16)));
+        s2 = _mm_xor_si128(s2, _mm_load_si128((const __m128i *)(src + i + 32)));
+        s3 = _mm_xor_si128(s3, _mm_load_si128((const __m128i *)(src + i + 48)));
+    }
+    s0 = _mm_xor_si128(_mm_xor_si128(s0, s1), _mm_xor_si128(s2, s3));
+    nt_sink = (uint64_t)_mm_cvtsi128_si64(s0);
+}
+
+typedef struct {
+    probe_ctx_t *ctx;
+    size_t sizes[MAX_SIZES];
+    int nsizes;
+    char *dst;
+    char *src;
+} nt_sweep_t;
+
+// points: size-major, then method, then phase (0 = write, 1 = read after)
+#define PHASES 2
+
+static void nt_decode(size_t i, int *s, int *m, int *phase) {
+    *phase = (int)(i % PHASES);
+    *m = (int)(i / PHASES % NUM_NT_METHODS);
+    *s = (int)(i / PHASES / NUM_NT_METHODS);
+}
+
+static void nt_setup(void *arg, size_t i) {
+    nt_sweep_t *sw = arg;
+    int s, m, phase;
+    nt_decode(i, &s, &m, &phase);
+    methods[m](sw->dst, sw->src, sw->sizes[s]);
+}
+
+static void nt_label(void *arg, size_t i, char *buf, size_t len) {
+    const nt_sweep_t *sw = arg;
+    int s, m, phase;
+    nt_decode(i, &s, &m, &phase);
+    snprintf(buf, len, "%s %s %zu KB", method_names[m], phase ? "read after" : "write",
+             sw->sizes[s] / KB);
+}
+
+// one rep's ticks less the start/stop cost; every rep has its own window
+// (the read-back rewrites dst untimed), so the overhead comes off each
+static uint64_t rep_ticks(uint64_t start, uint64_t end) {
+    return end - start > timer.overhead ? end - start - timer.overhead : 0;
+}
+
+// ns per byte written, or per byte read back right after the write
+static double nt_trial(void *arg, size_t i) {
+    nt_sweep_t *sw = arg;
+    int s, m, phase;
+    nt_decode(i, &s, &m, &phase);
+    size_t n = sw->sizes[s];
+
+    size_t target = sw->ctx->opt.iterations * CACHE_LINE_SIZE;
+    size_t reps = target / n ? target / n : 1;
+    uint64_t elapsed = 0;
+
+    counters_begin();
+    for (size_t r = 0; r < reps; r++) {
+        if (phase == 0) {
+            uint64_t start = timer_start();
+            methods[m](sw->dst, sw->src, n);
+            uint64_t end = timer_stop();
+            elapsed += rep_ticks(start, end);
+        } else {
+            methods[m](sw->dst, sw->src, n);
+            uint64_t start = timer_start();
+            read_back(sw->dst, n);
+            uint64_t end = timer_stop();
+            elapsed += rep_ticks(start, end);
+        }
+    }
+    counters_end(reps * n / CACHE_LINE_SIZE);
+
+    return (double)elapsed / timer.ticks_per_ns / (double)(reps * n);
+}
+
+// smallest size from which a beats b at every larger size too
+static size_t crossover(const nt_sweep_t *sw, const double *a, const double *b) {
+    size_t at = 0;
+    for (int s = sw->nsizes - 1; s >= 0; s--) {
+        if (a[s] > b[s]) break;
+        at = sw->sizes[s];
+    }
+    return at;
+}
+
+static void print_crossover(const char *what, size_t at) {
+    if (at) printf("%s: from %zu KB\n", what, at / KB);
+    else printf("%s: never in this range\n", what);
+}
+
+int probe_nt(probe_ctx_t *ctx, int argc, char **argv) {
+    long l2 = sysfs_cache_size(ctx->opt.core, 2);
+    long l3 = sysfs_cache_size(ctx->opt.core, 3);
+    size_t min_bytes = l2 > 0 ? (size_t)l2 / 2 : 256 * KB;
+    size_t max_bytes = l3 > 0 ? (size_t)l3 * 8 : 256 * MB;
+
+    static const struct option longopts[] = {
+        { "min", required_argument, NULL, 'm' },
+        { "max", required_argument, NULL, 'M' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+        case 'm': min_bytes = parse_size(optarg); break;
+        case 'M': max_bytes = parse_size(optarg); break;
+        default:
+            fprintf(stderr, "Usage: memprobe nt [--min=SIZE] [--max=SIZE]\n");
+            return 1;
+        }
+    }
+    // copies need a source half and a destination half
+    if (max_bytes > ctx->arena.size / 2) max_bytes = ctx->arena.size / 2;
+    min_bytes = (min_bytes + 63) & ~(size_t)63;
+    if (min_bytes < 4 * KB) min_bytes = 4 * KB;
+
+    static nt_sweep_t sw;
+    sw.ctx = ctx;
+    sw.dst = ctx->arena.base;
+    sw.src = ctx->arena.base + ctx->arena.size / 2;
+    sw.nsizes = 0;
+    for (size_t b = min_bytes; b <= max_bytes && sw.nsizes < MAX_SIZES; b *= 2) {
+        sw.sizes[sw.nsizes++] = b;
+    }
+    if (sw.nsizes == 0) {
+        fprintf(stderr, "nt: arena too small for --min\n");
+        return 1;
+    }
+
+    size_t n = (size_t)sw.nsizes * NUM_NT_METHODS * PHASES;
+    stats_t *st = calloc(n, sizeof(stats_t));
+    if (!st) {
+        perror("calloc");
+        return 1;
+    }
+    point_ops_t ops = { nt_setup, nt_trial, &sw, nt_label, "ns/byte" };
+    measure_points(ctx, n, &ops, st);
+
+    printf("Streaming Store Probe (GB/s write | GB/s read right after)\n");
+    printf("Size(KB)");
+    for (int m = 0; m < NUM_NT_METHODS; m++) printf("\t%s", method_names[m]);
+    printf("\n--------------------------------------------------------------------------------\n");
+
+    double w[NUM_NT_METHODS][MAX_SIZES], rd[NUM_NT_METHODS][MAX_SIZES];
+    double both[NUM_NT_METHODS][MAX_SIZES];
+    for (int s = 0; s < sw.nsizes; s++) {
+        printf("%zu\t", sw.sizes[s] / KB);
+        for (int m = 0; m < NUM_NT_METHODS; m++) {
+            size_t i = ((size_t)s * NUM_NT_METHODS + m) * PHASES;
+            w[m][s] = st[i].median;
+            rd[m][s] = st[i + 1].median;
+            both[m][s] = w[m][s] + rd[m][s];
+            printf("\t%.1f|%.1f", 1.0 / w[m][s], 1.0 / rd[m][s]);
+        }
+        printf("\n");
+    }
+
+    printf("\nCrossover (streaming no slower at this size and above)\n");
+    print_crossover("movntdq vs store, write only",
+                    crossover(&sw, w[NT_STREAM], w[NT_STORE]));
+    print_crossover("movntdq vs store, write + read back",
+                    crossover(&sw, both[NT_STREAM], both[NT_STORE]));
+    print_crossover("copy_nt vs copy, write only",
+                    crossover(&sw, w[NT_COPY_STREAM], w[NT_COPY]));
+    print_crossover("copy_nt vs copy, write + read back",
+                    crossover(&sw, both[NT_COPY_STREAM], both[NT_COPY]));
+    print_crossover("stosb vs store, write only",
+                    crossover(&sw, w[NT_STOSB], w[NT_STORE]));
+    print_crossover("movsb vs copy, write only",
+                    crossover(&sw, w[NT_MOVSB], w[NT_COPY]));
+
+    free(st);
+    return 0;
+}
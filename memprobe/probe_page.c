@@ -0,0 +1,66 @@
+// probe_page.c
+// page size probe: a fixed number of nodes at a growing stride. below the
+// page size several nodes share a page; above it every node has its own,
+// so the curve rises and then flattens at the page size.
+#include <getopt.h>
+#include <stdio.h>
+
+#include "memprobe.h"
+
+#define NUM_NODES 10000
+
+static const size_t strides[] = { 512, 1024, 2048, 4096, 8192, 16384, 0 };
+
+typedef struct {
+    chase_point_t cp;
+    size_t nodes;
+} page_sweep_t;
+
+static void page_setup(void *arg, size_t i) {
+    page_sweep_t *sw = arg;
+    sw->cp.head = chain_strided(sw->cp.ctx->arena.base, sw->nodes, strides[i]);
+    sw->cp.head = chase(sw->cp.head, sw->nodes);
+}
+
+static void page_label(void *arg, size_t i, char *buf, size_t len) {
+    const page_sweep_t *sw = arg;
+    snprintf(buf, len, "%zu nodes stride %zu B", sw->nodes, strides[i]);
+}
+
+int probe_page(probe_ctx_t *ctx, int argc, char **argv) {
+    size_t nodes = NUM_NODES;
+
+    static const struct option longopts[] = {
+        { "nodes", required_argument, NULL, 'n' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+        case 'n': nodes = parse_size(optarg); break;
+        default:
+            fprintf(stderr, "Usage: memprobe page [--nodes=N]\n");
+            return 1;
+        }
+    }
+
+    printf("Page Size Probe (%zu Nodes, Variable Stride)\n", nodes);
+
+    size_t n = 0;
+    while (strides[n] != 0 && nodes * strides[n] <= ctx->arena.size) n++;
+
+    page_sweep_t sw = { .cp = { ctx, NULL }, .nodes = nodes };
+    point_ops_t ops = { page_setup, chase_trial, &sw, page_label };
+    stats_t st[sizeof(strides) / sizeof(strides[0])];
+    measure_points(ctx, n, &ops, st);
+
+    print_stats_header("Stride(B)");
+    for (size_t i = 0; i < n; i++) {
+        char label[32];
+        snprintf(label, sizeof(label), "%zu", strides[i]);
+        print_stats_row(label, &st[i]);
+    }
+
+    return 0;
+}
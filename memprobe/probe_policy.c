@@ -0,0 +1,481 @@
+// probe_policy.c
+// replacement policy per level. take lines that all map to one set of the
+// level (a stride for L1d, a page color for L2, an eviction set from evset.c
+// for the LLC), chase cyclic access sequences over them and turn the ns per
+// hop into a miss rate between the level's hit and miss plateaus. the same
+// sequences run through small simulators of the usual policies; the one
+// whose steady-state miss rates sit closest wins. a block can show up more
+// than once per cycle because each visit uses its own 8-byte slot of the
+// line.
+//
+// the sequences: cyclic over W, W+1, 1.5W and 2W blocks (LRU and FIFO
+// thrash from W+1 on, random and BRRIP keep a share), a hot half visited
+// twice between scans (RRIP keeps it, LRU doesn't), W blocks plus a re-touch
+// of the first (tree-PLRU and NRU part ways with LRU there), and random
+// sequences that tell the rest apart. for the LLC the 2W cycle is run again
+// after sweeping far more than the LLC and after re-reading half of it: a
+// policy that switches with the workload (set dueling) misses differently.
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memprobe.h"
+
+#define MAX_POLICY_WAYS 32
+#define MAX_BLOCKS (2 * MAX_POLICY_WAYS)
+#define MAX_SEQ 128
+#define MAX_SEQS 32
+#define SLOTS (CACHE_LINE_SIZE / sizeof(void *))  // visits per block per cycle
+#define DEFAULT_RANDOM 8
+#define SIM_WARM 32                // cycles before the simulators count
+#define SIM_COUNT 64
+#define ADAPT_DELTA 0.2            // miss rate shift that counts as adapting
+
+typedef enum {
+    POL_LRU,
+    POL_FIFO,
+    POL_PLRU,      // tree pseudo-LRU, power-of-two ways only
+    POL_NRU,       // one MRU bit per way (bit-PLRU)
+    POL_SRRIP,     // 2-bit RRPV, insert at 2
+    POL_BRRIP,     // insert at 3, 1 in 32 at 2
+    POL_RANDOM,
+    NUM_POLICIES
+} policy_t;
+
+static const char *const policy_names[NUM_POLICIES] = {
+    "LRU", "FIFO", "PLRU", "NRU", "SRRIP", "BRRIP", "Random",
+};
+
+typedef struct {
+    char name[24];
+    size_t len;
+    uint8_t block[MAX_SEQ];
+} seq_t;
+
+typedef struct {
+    policy_t pol;
+    int ways;
+    int block[MAX_POLICY_WAYS];     // -1 while the way is empty
+    uint64_t state[MAX_POLICY_WAYS];// LRU/FIFO stamp, NRU bit or RRPV
+    uint8_t tree[MAX_POLICY_WAYS];  // PLRU nodes 1..ways-1, 1 = go right
+    uint64_t clock;
+    uint64_t rng;
+} sim_t;
+
+typedef struct {
+    chase_point_t cp;
+    const char *level;
+    char *lines[MAX_BLOCKS];
+    const seq_t *seqs;
+    char *sweep;               // LLC adapt check: buffer swept before each trial
+    size_t sweep_bytes;
+    int sweep_passes;
+} policy_sweep_t;
+
+static uint64_t sim_rand(sim_t *s) {
+    s->rng ^= s->rng << 13;
+    s->rng ^= s->rng >> 7;
+    s->rng ^= s->rng << 17;
+    return s->rng;
+}
+
+static void plru_touch(sim_t *s, int way) {
+    for (int n = way + s->ways; n > 1; n /= 2) s->tree[n / 2] = !(n & 1);
+}
+
+static void sim_touch(sim_t *s, int way, int hit) {
+    switch (s->pol) {
+    case POL_LRU: s->state[way] = ++s->clock; break;
+    case POL_FIFO: if (!hit) s->state[way] = ++s->clock; break;
+    case POL_PLRU: plru_touch(s, way); break;
+    case POL_NRU: {
+        s->state[way] = 1;
+        int all = 1;
+        for (int w = 0; w < s->ways; w++) all &= s->state[w] == 1;
+        if (all) {
+            for (int w = 0; w < s->ways; w++) s->state[w] = w == way;
+        }
+        break;
+    }
+    case POL_SRRIP: s->state[way] = hit ? 0 : 2; break;
+    case POL_BRRIP: s->state[way] = hit ? 0 : sim_rand(s) % 32 ? 3 : 2; break;
+    default: break;
+    }
+}
+
+static int sim_victim(sim_t *s) {
+    int v = 0;
+    switch (s->pol) {
+    case POL_LRU:
+    case POL_FIFO:
+        for (int w = 1; w < s->ways; w++) {
+            if (s->state[w] < s->state[v]) v = w;
+        }
+        return v;
+    case POL_PLRU: {
+        int n = 1;
+        while (n < s->ways) n = 2 * n + s->tree[n];
+        return n - s->ways;
+    }
+    case POL_NRU:
+        for (int w = 0; w < s->ways; w++) {
+            if (s->state[w] == 0) return w;
+        }
+        return 0;
+    case POL_SRRIP:
+    case POL_BRRIP:
+        for (;;) {
+            for (int w = 0; w < s->ways; w++) {
+                if (s->state[w] >= 3) return w;
+            }
+            for (int w = 0; w < s->ways; w++) s->state[w]++;
+        }
+    default:
+        return (int)(sim_rand(s) % (uint64_t)s->ways);
+    }
+}
+
+static int sim_access(sim_t *s, int block) {
+    int way = -1;
+    for (int w = 0; w < s->ways; w++) {
+        if (s->block[w] == block) {
+            sim_touch(s, w, 1);
+            return 1;
+        }
+        if (way < 0 && s->block[w] < 0) way = w;
+    }
+    if (way < 0) way = sim_victim(s);
+    s->block[way] = block;
+    sim_touch(s, way, 0);
+    return 0;
+}
+
+// steady-state misses per access of the sequence run cyclically, -1 if the
+// policy doesn't exist at this way count
+static double sim_miss_rate(policy_t pol, int ways, const seq_t *seq) {
+    if (pol == POL_PLRU && (ways & (ways - 1))) return -1;
+    sim_t s;
+    memset(&s, 0, sizeof(s));
+    s.pol = pol;
+    s.ways = ways;
+    s.rng = 0x9e3779b97f4a7c15ULL;
+    for (int w = 0; w < ways; w++) s.block[w] = -1;
+
+    size_t misses = 0;
+    for (int it = 0; it < SIM_WARM + SIM_COUNT; it++) {
+        for (size_t i = 0; i < seq->len; i++) {
+            int hit = sim_access(&s, seq->block[i]);
+            if (it >= SIM_WARM) misses += !hit;
+        }
+    }
+    return (double)misses / (double)(SIM_COUNT * seq->len);
+}
+
+static void seq_cyclic(seq_t *seq, size_t blocks) {
+    snprintf(seq->name, sizeof(seq->name), "cyc %zu", blocks);
+    seq->len = blocks;
+    for (size_t i = 0; i < blocks; i++) seq->block[i] = (uint8_t)i;
+}
+
+// the sequences for a level with this many ways, none touching more than
+// nblocks blocks. returns how many.
+static size_t build_sequences(int ways, size_t nblocks, int nrandom, seq_t *seqs) {
+    size_t w = (size_t)ways, n = 0;
+    size_t cyc[] = { w, w + 1, w + w / 2, 2 * w };
+    for (size_t i = 0; i < 4; i++) {
+        if (cyc[i] <= nblocks) seq_cyclic(&seqs[n++], cyc[i]);
+    }
+
+    // hot half twice, then a scan of W new blocks
+    if (w / 2 + w <= nblocks) {
+        seq_t *s = &seqs[n++];
+        snprintf(s->name, sizeof(s->name), "hot+scan");
+        s->len = 0;
+        for (int pass = 0; pass < 2; pass++) {
+            for (size_t b = 0; b < w / 2; b++) s->block[s->len++] = (uint8_t)b;
+        }
+        for (size_t b = 0; b < w; b++) s->block[s->len++] = (uint8_t)(w / 2 + b);
+    }
+
+    // W blocks, the first again, then one more
+    if (w + 1 <= nblocks) {
+        seq_t *s = &seqs[n++];
+        snprintf(s->name, sizeof(s->name), "retouch");
+        s->len = 0;
+        for (size_t b = 0; b < w; b++) s->block[s->len++] = (uint8_t)b;
+        s->block[s->len++] = 0;
+        s->block[s->len++] = (uint8_t)w;
+    }
+
+    for (int r = 0; r < nrandom && n < MAX_SEQS; r++) {
+        seq_t *s = &seqs[n++];
+        size_t blocks = w + 1 + (size_t)(chain_rand() % (w / 2 + 1));
+        if (blocks > nblocks) blocks = nblocks;
+        size_t len = 2 * w + (size_t)(chain_rand() % (w + 1));
+        if (len > MAX_SEQ) len = MAX_SEQ;
+        snprintf(s->name, sizeof(s->name), "rand %d", r);
+
+        size_t uses[MAX_BLOCKS] = { 0 };
+        s->len = 0;
+        while (s->len < len) {
+            size_t b = (size_t)(chain_rand() % blocks);
+            if (uses[b] == SLOTS) continue;
+            if (s->len > 0 && s->block[s->len - 1] == b) continue;
+            uses[b]++;
+            s->block[s->len++] = (uint8_t)b;
+        }
+        // the cycle wraps, so the ends mustn't repeat either
+        if (s->len > 1 && s->block[0] == s->block[s->len - 1]) s->len--;
+    }
+    return n;
+}
+
+// visit k of block b is slot k of line b
+static void policy_setup(void *arg, size_t i) {
+    policy_sweep_t *sw = arg;
+    const seq_t *seq = &sw->seqs[i];
+    char *nodes[MAX_SEQ];
+    size_t uses[MAX_BLOCKS] = { 0 };
+    for (size_t k = 0; k < seq->len; k++) {
+        size_t b = seq->block[k];
+        nodes[k] = sw->lines[b] + uses[b]++ * sizeof(void *);
+    }
+    sw->cp.head = chain_list(nodes, seq->len);
+    sw->cp.head = chase(sw->cp.head, seq->len * SIM_WARM);
+}
+
+static void policy_label(void *arg, size_t i, char *buf, size_t len) {
+    const policy_sweep_t *sw = arg;
+    snprintf(buf, len, "%s %s", sw->level, sw->seqs[i].name);
+}
+
+static volatile uint64_t policy_sink;
+
+// condition the LLC with a sweep, then time the chain
+static double adapt_trial(void *arg, size_t i) {
+    policy_sweep_t *sw = arg;
+    uint64_t x = 0;
+    for (int pass = 0; pass < sw->sweep_passes; pass++) {
+        for (size_t off = 0; off < sw->sweep_bytes; off += CACHE_LINE_SIZE) {
+            x += *(volatile const uint64_t *)(sw->sweep + off);
+        }
+    }
+    policy_sink += x;
+    sw->cp.head = chase(sw->cp.head, sw->seqs[i].len * SIM_WARM);
+    return chase_trial(arg, i);
+}
+
+static double plateau(probe_ctx_t *ctx, size_t bytes, const char *label) {
+    if (bytes > ctx->arena.size) bytes = ctx->arena.size;
+    chase_point_t cp = { ctx, chain_random(ctx->arena.base, bytes, CACHE_LINE_SIZE) };
+    cp.head = chase(cp.head, bytes / CACHE_LINE_SIZE);
+    stats_t st;
+    measure_point(&ctx->opt, chase_trial, &cp, 0, label, &st);
+    return st.median;
+}
+
+static double miss_fraction(double ns, double hit, double miss) {
+    double f = (ns - hit) / (miss - hit);
+    return f < 0 ? 0 : f > 1 ? 1 : f;
+}
+
+// lines that share one LLC set: a minimal eviction set, its target and
+// whatever else in the pool it evicts
+static size_t llc_lines(probe_ctx_t *ctx, int ways, char **lines, size_t want) {
+    long llc = sysfs_cache_size(ctx->opt.core, 3);
+    size_t classes = (llc > 0 ? (size_t)llc : 32 * MB) / ((size_t)ways * PAGE_SIZE);
+    evset_ctx_t ev;
+    if (evset_init(&ev, ctx, 0, ctx->arena.size / PAGE_SIZE, (size_t)ways) != 0) return 0;
+    if (evset_fit_pool(&ev, 2 * (size_t)ways * (classes ? classes : 1)) == 0) {
+        evset_free(&ev);
+        return 0;
+    }
+
+    char **work = malloc(ev.npool * sizeof(char *));
+    size_t n = 0;
+    for (size_t t = 0; work && t < 4 && n == 0; t++) {
+        char *target = ev.pool[(size_t)(chain_rand() % ev.npool)];
+        size_t got = evset_build(&ev, target, work, 2);
+        if (got == 0 || got > want) continue;
+        memcpy(lines, work, got * sizeof(char *));
+        lines[got] = target;
+        n = got + 1;
+        n += evset_congruent(&ev, lines, n, lines + n, want - n);
+    }
+    free(work);
+    evset_free(&ev);
+    return n;
+}
+
+static void run_level(probe_ctx_t *ctx, const char *name, int index, int nrandom) {
+    long ways_l = sysfs_cache_value(ctx->opt.core, index, "ways_of_associativity");
+    long sets = sysfs_cache_value(ctx->opt.core, index, "number_of_sets");
+    long size = sysfs_cache_size(ctx->opt.core, index);
+    printf("\n%s: ", name);
+    if (ways_l < 2 || ways_l > MAX_POLICY_WAYS || sets <= 0 || size <= 0) {
+        printf("no usable ways/sets in sysfs, skipped\n");
+        return;
+    }
+    int ways = (int)ways_l;
+    size_t want = 2 * (size_t)ways;
+
+    static policy_sweep_t sw;
+    memset(&sw, 0, sizeof(sw));
+    sw.cp.ctx = ctx;
+    sw.level = name;
+    size_t have = 0;
+    const char *how;
+    if (index == 0) {
+        size_t span = (size_t)sets * CACHE_LINE_SIZE;
+        for (; have < want && (have + 1) * span <= ctx->arena.size; have++) {
+            sw.lines[have] = ctx->arena.base + have * span;
+        }
+        how = "virtual stride";
+    } else if (index == 2) {
+        color_map_t cm;
+        if (colors_init(&cm, &ctx->arena, (size_t)sets * CACHE_LINE_SIZE) != 0) return;
+        have = color_lines(&cm, 0, CACHE_LINE_SIZE, sw.lines, want);
+        how = cm.physical ? "page color" : "page color, virtual only";
+        colors_free(&cm);
+    } else {
+        have = llc_lines(ctx, ways, sw.lines, want);
+        how = "eviction set";
+    }
+    if (have < (size_t)ways + 1) {
+        printf("%d ways, only %zu same-set lines (%s), skipped\n", ways, have, how);
+        return;
+    }
+
+    // next level: L1d -> L2 -> LLC -> memory
+    long next = index == 0 ? sysfs_cache_size(ctx->opt.core, 2)
+              : index == 2 ? sysfs_cache_size(ctx->opt.core, 3) : 0;
+    char hit_label[32], miss_label[32];
+    snprintf(hit_label, sizeof(hit_label), "%s hit", name);
+    snprintf(miss_label, sizeof(miss_label), "%s miss", name);
+    double hit = plateau(ctx, (size_t)size / 2, hit_label);
+    double miss = plateau(ctx, next > 0 ? (size_t)next / 2 : 4 * (size_t)size, miss_label);
+    printf("%d ways, %zu same-set lines (%s), hit %.1f ns, miss %.1f ns\n",
+           ways, have, how, hit, miss);
+    if (miss < 1.2 * hit) {
+        printf("hit and miss too close to tell apart, skipped\n");
+        return;
+    }
+
+    static seq_t seqs[MAX_SEQS];
+    size_t nseq = build_sequences(ways, have, nrandom, seqs);
+    sw.seqs = seqs;
+    stats_t st[MAX_SEQS];
+    point_ops_t ops = { policy_setup, chase_trial, &sw, policy_label };
+    measure_points(ctx, nseq, &ops, st);
+
+    printf("Sequence\tLen\tMeasured");
+    for (int p = 0; p < NUM_POLICIES; p++) printf("\t%s", policy_names[p]);
+    printf("\n");
+    printf("----------------------------------------------------------------------------------------\n");
+    double err[NUM_POLICIES] = { 0 };
+    double worst = 0;
+    for (size_t i = 0; i < nseq; i++) {
+        double m = miss_fraction(st[i].median, hit, miss);
+        if (m > worst) worst = m;
+        printf("%s\t\t%zu\t%.2f", seqs[i].name, seqs[i].len, m);
+        for (int p = 0; p < NUM_POLICIES; p++) {
+            double s = sim_miss_rate((policy_t)p, ways, &seqs[i]);
+            if (s < 0) {
+                err[p] = -1;
+                printf("\t-");
+                continue;
+            }
+            if (err[p] >= 0) err[p] += fabs(s - m);
+            printf("\t%.2f", s);
+        }
+        printf("\n");
+    }
+    printf("mean error\t\t");
+    int best = -1, second = -1;
+    for (int p = 0; p < NUM_POLICIES; p++) {
+        if (err[p] < 0) {
+            printf("\t-");
+            continue;
+        }
+        err[p] /= (double)nseq;
+        printf("\t%.2f", err[p]);
+        if (best < 0 || err[p] < err[best]) {
+            second = best;
+            best = p;
+        } else if (second < 0 || err[p] < err[second]) {
+            second = p;
+        }
+    }
+    printf("\n");
+    // W + 1 blocks of one set miss under every policy but random
+    if (worst < 0.05) {
+        printf("%s: the lines never conflict, they aren't one set%s\n", name,
+               index != 0 && under_hypervisor() ? " (pagemap is guest-physical here)" : "");
+        return;
+    }
+    printf("%s best match: %s (mean error %.2f)", name, policy_names[best], err[best]);
+    if (second >= 0) printf(", next %s (%.2f)", policy_names[second], err[second]);
+    printf("\n");
+
+    if (index != 3) return;
+
+    // set dueling: a long scan favours BRRIP, reuse within the LLC favours
+    // SRRIP/LRU. longest cycle after each, in the same trials loop.
+    size_t cyc = 0;
+    for (size_t i = 0; i < nseq; i++) {
+        if (strncmp(seqs[i].name, "cyc", 3) == 0 && seqs[i].len > seqs[cyc].len) cyc = i;
+    }
+    size_t scan = 3 * (size_t)size / 2;
+    if (scan > ctx->arena.size) scan = ctx->arena.size;
+    double rate[2];
+    for (int mode = 0; mode < 2; mode++) {
+        sw.sweep = ctx->arena.base + ctx->arena.size - (mode ? (size_t)size / 2 : scan);
+        sw.sweep_bytes = mode ? (size_t)size / 2 : scan;
+        sw.sweep_passes = mode ? 4 : 2;
+        policy_setup(&sw, cyc);
+        char label[64];
+        snprintf(label, sizeof(label), "%s %.23s after %s", name, seqs[cyc].name,
+                 mode ? "re-read" : "scan");
+        stats_t ast;
+        measure_point(&ctx->opt, adapt_trial, &sw, cyc, label, &ast);
+        rate[mode] = miss_fraction(ast.median, hit, miss);
+    }
+    printf("LLC after a %zu MB scan: %s miss rate %.2f, after re-reading %zu MB: %.2f -> %s\n",
+           scan / MB, seqs[cyc].name, rate[0], (size_t)size / 2 / MB, rate[1],
+           fabs(rate[0] - rate[1]) > ADAPT_DELTA ? "adapts (set dueling or similar)"
+                                                 : "no sign of adapting");
+}
+
+int probe_policy(probe_ctx_t *ctx, int argc, char **argv) {
+    const char *levels = "l1d,l2,llc";
+    int nrandom = DEFAULT_RANDOM;
+
+    static const struct option longopts[] = {
+        { "levels", required_argument, NULL, 'L' },
+        { "random", required_argument, NULL, 'r' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+        case 'L': levels = optarg; break;
+        case 'r': nrandom = atoi(optarg); break;
+        default:
+            fprintf(stderr, "Usage: memprobe policy [--levels=l1d,l2,llc] [--random=N]\n");
+            return 1;
+        }
+    }
+    if (nrandom < 0 || nrandom > MAX_SEQS - 6) {
+        fprintf(stderr, "policy: --random must be 0..%d\n", MAX_SEQS - 6);
+        return 1;
+    }
+
+    printf("Replacement Policy Probe (miss rates per access, steady state)\n");
+    if (strstr(levels, "l1d")) run_level(ctx, "L1d", 0, nrandom);
+    if (strstr(levels, "l2")) run_level(ctx, "L2", 2, nrandom);
+    if (strstr(levels, "llc")) run_level(ctx, "LLC", 3, nrandom);
+    return 0;
+}
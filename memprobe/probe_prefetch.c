@@ -0,0 +1,238 @@
+// probe_prefetch.c
+// what the hardware prefetchers cover. every pattern is a chase over the
+// same lines of a working set parked in one level (L2, the LLC or memory),
+// only the visiting order changes: random order is the baseline nothing can
+// prefetch, an L1 hit is the floor. coverage = how much of the gap between
+// the two a pattern closes. since each hop depends on the one before, only
+// a prefetcher that runs ahead on its own can help.
+//
+// patterns: sequential forward and backward, fixed strides (every line is
+// still visited, the walk just wraps round offset by a line), adjacent-line
+// pairs in random pair order (the buddy of a 128-byte pair arrives with the
+// first half), and each page read sequentially but pages in random order,
+// which next to plain sequential shows whether a stream survives a page
+// boundary. in memory the random baseline also pays for TLB misses, which
+// --pages=thp takes out of the picture.
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memprobe.h"
+
+#define MIN_STRIDE 128
+#define MAX_STRIDE (16 * KB)
+#define COVERED 0.5                // coverage from which a pattern counts as covered
+#define PARTLY 0.2
+
+typedef enum {
+    PAT_RANDOM,
+    PAT_SEQ,
+    PAT_BACKWARD,
+    PAT_PAIRS,
+    PAT_PAGE_SEQ,
+    PAT_STRIDE,                    // one point per stride from here on
+} pattern_t;
+
+static const char *const pattern_names[] = {
+    "random", "sequential", "backward", "adjacent pairs", "in-page seq",
+};
+
+typedef struct {
+    chase_point_t cp;
+    const char *from;          // level the working set sits in
+    size_t bytes;
+    char **nodes;
+} prefetch_sweep_t;
+
+static size_t num_strides(void) {
+    size_t n = 0;
+    for (size_t s = MIN_STRIDE; s <= MAX_STRIDE; s *= 2) n++;
+    return n;
+}
+
+static size_t stride_of(size_t i) {
+    return (size_t)MIN_STRIDE << (i - PAT_STRIDE);
+}
+
+static void shuffle(size_t *v, size_t n) {
+    for (size_t i = n - 1; i > 0; i--) {
+        size_t k = (size_t)(chain_rand() % (i + 1));
+        size_t temp = v[i];
+        v[i] = v[k];
+        v[k] = temp;
+    }
+}
+
+// visiting order of point i over every line of the working set
+static int fill_order(prefetch_sweep_t *sw, size_t i) {
+    char *base = sw->cp.ctx->arena.base;
+    size_t lines = sw->bytes / CACHE_LINE_SIZE;
+    size_t per_page = PAGE_SIZE / CACHE_LINE_SIZE;
+    size_t n = 0;
+
+    if (i == PAT_SEQ || i == PAT_BACKWARD) {
+        for (size_t l = 0; l < lines; l++) {
+            size_t k = i == PAT_SEQ ? l : lines - 1 - l;
+            sw->nodes[n++] = base + k * CACHE_LINE_SIZE;
+        }
+        return 0;
+    }
+    if (i >= PAT_STRIDE) {
+        size_t stride = stride_of(i);
+        for (size_t off = 0; off < stride; off += CACHE_LINE_SIZE) {
+            for (size_t at = off; at < sw->bytes; at += stride) sw->nodes[n++] = base + at;
+        }
+        return 0;
+    }
+
+    // the rest shuffle units of 1, 2 or a page's worth of lines
+    size_t unit = i == PAT_PAIRS ? 2 : i == PAT_PAGE_SEQ ? per_page : 1;
+    size_t units = lines / unit;
+    size_t *order = malloc(units * sizeof(size_t));
+    if (!order) return -1;
+    for (size_t u = 0; u < units; u++) order[u] = u;
+    shuffle(order, units);
+    for (size_t u = 0; u < units; u++) {
+        for (size_t l = 0; l < unit; l++) {
+            sw->nodes[n++] = base + (order[u] * unit + l) * CACHE_LINE_SIZE;
+        }
+    }
+    free(order);
+    return 0;
+}
+
+static void prefetch_setup(void *arg, size_t i) {
+    prefetch_sweep_t *sw = arg;
+    if (fill_order(sw, i) != 0) {
+        sw->cp.head = NULL;
+        return;
+    }
+    sw->cp.head = chain_list(sw->nodes, sw->bytes / CACHE_LINE_SIZE);
+    sw->cp.head = chase(sw->cp.head, sw->bytes / CACHE_LINE_SIZE);
+}
+
+// no order (out of memory) means no chain: skip the point
+static double prefetch_trial(void *arg, size_t i) {
+    prefetch_sweep_t *sw = arg;
+    if (!sw->cp.head) return -1.0;
+    return chase_trial(arg, i);
+}
+
+static void prefetch_label(void *arg, size_t i, char *buf, size_t len) {
+    const prefetch_sweep_t *sw = arg;
+    if (i >= PAT_STRIDE) snprintf(buf, len, "%s stride %zu B", sw->from, stride_of(i));
+    else snprintf(buf, len, "%s %s", sw->from, pattern_names[i]);
+}
+
+static double coverage(double ns, double random, double floor) {
+    double c = (random - ns) / (random - floor);
+    return c < 0 ? 0 : c > 1 ? 1 : c;
+}
+
+static const char *verdict(double c) {
+    return c >= COVERED ? "covered" : c >= PARTLY ? "partly" : "no";
+}
+
+static void run_level(probe_ctx_t *ctx, const char *from, size_t bytes, double floor) {
+    bytes = bytes / MAX_STRIDE * MAX_STRIDE;
+    if (bytes > ctx->arena.size) bytes = ctx->arena.size / MAX_STRIDE * MAX_STRIDE;
+    if (bytes < 2 * MAX_STRIDE) return;
+
+    static prefetch_sweep_t sw;
+    sw.cp.ctx = ctx;
+    sw.from = from;
+    sw.bytes = bytes;
+    sw.nodes = malloc(bytes / CACHE_LINE_SIZE * sizeof(char *));
+    if (!sw.nodes) {
+        perror("malloc");
+        return;
+    }
+
+    size_t n = PAT_STRIDE + num_strides();
+    stats_t *st = calloc(n, sizeof(stats_t));
+    if (!st) {
+        perror("calloc");
+        free(sw.nodes);
+        return;
+    }
+    point_ops_t ops = { prefetch_setup, prefetch_trial, &sw, prefetch_label };
+    measure_points(ctx, n, &ops, st);
+
+    double random = st[PAT_RANDOM].median;
+    printf("\nfrom %s (%zu KB working set): random %.1f ns, L1 hit %.1f ns\n",
+           from, bytes / KB, random, floor);
+    printf("Pattern\t\tns/access\tcoverage\n");
+    printf("------------------------------------------------\n");
+    for (size_t i = 0; i < n; i++) {
+        char label[32];
+        if (i >= PAT_STRIDE) snprintf(label, sizeof(label), "stride %zu", stride_of(i));
+        else snprintf(label, sizeof(label), "%s", pattern_names[i]);
+        double c = coverage(st[i].median, random, floor);
+        printf("%s\t%s%.2f\t\t%.2f\t%s\n", label, strlen(label) < 8 ? "\t" : "", st[i].median,
+               c, i == PAT_RANDOM ? "-" : verdict(c));
+    }
+
+    // summary: covered patterns, and the first stride that isn't
+    printf("from %s covers:", from);
+    int any = 0;
+    for (size_t i = PAT_SEQ; i < PAT_STRIDE; i++) {
+        if (coverage(st[i].median, random, floor) >= COVERED) {
+            printf("%s %s", any ? "," : "", pattern_names[i]);
+            any = 1;
+        }
+    }
+    if (!any) printf(" nothing");
+    size_t stop = 0;
+    for (size_t i = PAT_STRIDE; i < n && !stop; i++) {
+        if (coverage(st[i].median, random, floor) < COVERED) stop = stride_of(i);
+    }
+    if (stop) printf("; strides stop being covered at %zu B", stop);
+    else printf("; strides covered up to %zu B", (size_t)MAX_STRIDE);
+    if (coverage(st[PAT_SEQ].median, random, floor) >=
+        coverage(st[PAT_PAGE_SEQ].median, random, floor) + PARTLY) {
+        printf("; streams run across page boundaries");
+    }
+    printf("\n");
+
+    free(st);
+    free(sw.nodes);
+}
+
+int probe_prefetch(probe_ctx_t *ctx, int argc, char **argv) {
+    const char *levels = "l2,llc,mem";
+
+    static const struct option longopts[] = {
+        { "levels", required_argument, NULL, 'L' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+        case 'L': levels = optarg; break;
+        default:
+            fprintf(stderr, "Usage: memprobe prefetch [--levels=l2,llc,mem]\n");
+            return 1;
+        }
+    }
+
+    long l1 = sysfs_cache_size(ctx->opt.core, 0);
+    long l2 = sysfs_cache_size(ctx->opt.core, 2);
+    long llc = sysfs_cache_size(ctx->opt.core, 3);
+    if (l1 <= 0) l1 = 32 * KB;
+    if (l2 <= 0) l2 = MB;
+    if (llc <= 0) llc = 32 * MB;
+
+    // the floor: a random chase over half the L1
+    chase_point_t cp = { ctx, chain_random(ctx->arena.base, (size_t)l1 / 2, CACHE_LINE_SIZE) };
+    cp.head = chase(cp.head, (size_t)l1 / 2 / CACHE_LINE_SIZE);
+    stats_t st;
+    measure_point(&ctx->opt, chase_trial, &cp, 0, "L1 floor", &st);
+
+    printf("Prefetcher Probe (coverage: 0 = random order, 1 = L1 hit)\n");
+    if (strstr(levels, "l2")) run_level(ctx, "L2", (size_t)l2 / 2, st.median);
+    if (strstr(levels, "llc")) run_level(ctx, "LLC", (size_t)llc / 2, st.median);
+    if (strstr(levels, "mem")) run_level(ctx, "memory", 4 * (size_t)llc, st.median);
+    return 0;
+}
@@ -0,0 +1,229 @@
+// probe_share.c
+// cache-sharing topology: which cores actually share each cache level.
+// for a pair (a, b) we chase a working set just under the level's capacity
+// on a while a helper thread pinned to b chases its own set of the same
+// size. if a and b share the cache the two sets don't fit together and a's
+// latency jumps; if they don't, a doesn't notice b at all. cores are grouped
+// greedily against one representative per group, and the groups are printed
+// next to what /sys/devices/system/cpu/*/cache claims.
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memprobe.h"
+
+#define SHARE_RATIO 1.3    // slowdown that counts as mutual eviction
+#define STOP_CHECK 4096    // helper hops between looks at the stop flag
+
+typedef struct {
+    int level;
+    int index;             // sysfs cache/indexN holding its size
+    const char *name;
+} share_level_t;
+
+static const share_level_t levels[] = {
+    { 1, 0, "L1d" },
+    { 2, 2, "L2" },
+    { 3, 3, "L3" },
+};
+
+typedef struct {
+    void **head;
+    int ready;
+    int stop;
+} helper_t;
+
+static void *helper_main(void *arg) {
+    helper_t *h = arg;
+    void **p = h->head;
+    __atomic_store_n(&h->ready, 1, __ATOMIC_RELEASE);
+    while (!__atomic_load_n(&h->stop, __ATOMIC_ACQUIRE)) {
+        p = chase(p, STOP_CHECK);
+    }
+    h->head = p;
+    return NULL;
+}
+
+// median ns per access on cpu a, with a helper chasing bg on cpu b (b < 0: alone)
+static double share_measure(probe_ctx_t *ctx, const char *level, void **fg, void **bg, int a,
+                            int b) {
+    helper_t h = { bg, 0, 0 };
+    pthread_t tid;
+
+    if (b >= 0) {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(b, &set);
+        pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+        int err = pthread_create(&tid, &attr, helper_main, &h);
+        pthread_attr_destroy(&attr);
+        if (err != 0) {
+            fprintf(stderr, "share: pthread_create: %s\n", strerror(err));
+            return -1.0;
+        }
+        while (!__atomic_load_n(&h.ready, __ATOMIC_ACQUIRE)) sched_yield();
+    }
+
+    // the warmup also gives the helper time to pull its own set in
+    pin_to_core(a);
+    chase_point_t cp = { ctx, fg };
+    chase(fg, ctx->opt.iterations / 4);
+    char label[64];
+    if (b >= 0) snprintf(label, sizeof(label), "%s cpu %d with %d", level, a, b);
+    else snprintf(label, sizeof(label), "%s cpu %d alone", level, a);
+    stats_t st;
+    measure_point(&ctx->opt, chase_trial, &cp, 0, label, &st);
+
+    if (b >= 0) {
+        __atomic_store_n(&h.stop, 1, __ATOMIC_RELEASE);
+        pthread_join(tid, NULL);
+    }
+    return st.median;
+}
+
+static void print_groups(const cpumask_t *groups, int ngroups) {
+    char buf[256];
+    for (int g = 0; g < ngroups; g++) {
+        format_cpu_list(&groups[g], buf, sizeof(buf));
+        printf(" {%s}", buf);
+    }
+    printf("\n");
+}
+
+int probe_share(probe_ctx_t *ctx, int argc, char **argv) {
+    cpumask_t cpus;
+    int have_cpus = 0;
+
+    static const struct option longopts[] = {
+        { "cpus", required_argument, NULL, 'C' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+        case 'C':
+            if (parse_cpu_list(optarg, &cpus) != 0) {
+                fprintf(stderr, "share: bad cpu list '%s'\n", optarg);
+                return 1;
+            }
+            have_cpus = 1;
+            break;
+        default:
+            fprintf(stderr, "Usage: memprobe share [--cpus=LIST]\n");
+            return 1;
+        }
+    }
+    if (!have_cpus && online_cpus(&cpus) != 0) {
+        fprintf(stderr, "share: can't read the online cpu list\n");
+        return 1;
+    }
+
+    int list[MAX_CPUS], ncpus = 0;
+    for (int cpu = 0; cpu < MAX_CPUS && cpu < CPU_SETSIZE; cpu++) {
+        if (cpumask_test(&cpus, cpu)) list[ncpus++] = cpu;
+    }
+    if (ncpus == 0) {
+        fprintf(stderr, "share: no cpus to test\n");
+        return 1;
+    }
+    char buf[256];
+    format_cpu_list(&cpus, buf, sizeof(buf));
+    printf("Cache Sharing Probe (cpus %s)\n", buf);
+    if (ncpus < 2) printf("only one cpu to test, every group is trivially that cpu\n");
+
+    static cpumask_t groups[MAX_CPUS], sysfs_groups[MAX_CPUS];
+    static double alone[MAX_CPUS];
+    int rep[MAX_CPUS];
+    char *fg_base = ctx->arena.base;
+    char *bg_base = ctx->arena.base + ctx->arena.size / 2;
+
+    for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+        long size = sysfs_cache_size(list[0], levels[l].index);
+        if (size <= 0) continue;
+
+        // just under capacity for each side, so one set fits and two don't
+        size_t ws = (size_t)size / 4 * 3;
+        ws &= ~(size_t)(CACHE_LINE_SIZE - 1);
+        if (ws > ctx->arena.size / 2) {
+            fprintf(stderr, "share: %s needs 2 x %zu KB, arena too small, skipping\n",
+                    levels[l].name, ws / KB);
+            continue;
+        }
+        void **fg = chain_random(fg_base, ws, CACHE_LINE_SIZE);
+        void **bg = chain_random(bg_base, ws, CACHE_LINE_SIZE);
+        if (!fg || !bg) continue;
+
+        printf("\n%s (%ld KB, %zu KB per core)\n", levels[l].name, size / KB, ws / KB);
+        if (ctx->opt.verbose) printf("  rep\tcpu\talone(ns)\tshared(ns)\tratio\n");
+
+        int ngroups = 0;
+        for (int i = 0; i < ncpus; i++) {
+            int cpu = list[i], g;
+            for (g = 0; g < ngroups; g++) {
+                int r = rep[g];
+                double with = share_measure(ctx, levels[l].name, fg, bg, r, cpu);
+                if (with < 0) {
+                    restore_affinity(&ctx->opt);
+                    return 1;
+                }
+                double ratio = with / alone[g];
+                if (ctx->opt.verbose) {
+                    printf("  %d\t%d\t%.3f\t\t%.3f\t\t%.2f\n", r, cpu, alone[g], with, ratio);
+                }
+                if (ratio > SHARE_RATIO) break;
+            }
+            if (g == ngroups) {
+                memset(&groups[g], 0, sizeof(groups[g]));
+                rep[g] = cpu;
+                alone[g] = share_measure(ctx, levels[l].name, fg, bg, cpu, -1);
+                ngroups++;
+            }
+            cpumask_set(&groups[g], cpu);
+        }
+
+        // sysfs view, limited to the cpus we tested
+        int nsysfs = 0, sysfs_ok = 1;
+        for (int i = 0; i < ncpus; i++) {
+            cpumask_t m;
+            if (sysfs_cache_shared(list[i], levels[l].level, &m) != 0) {
+                sysfs_ok = 0;
+                break;
+            }
+            for (int k = 0; k < MAX_CPUS / 64; k++) m.bits[k] &= cpus.bits[k];
+            int seen = 0;
+            for (int g = 0; g < nsysfs && !seen; g++) {
+                seen = memcmp(&sysfs_groups[g], &m, sizeof(m)) == 0;
+            }
+            if (!seen) sysfs_groups[nsysfs++] = m;
+        }
+
+        printf("measured:");
+        print_groups(groups, ngroups);
+        if (!sysfs_ok) {
+            printf("sysfs:    unavailable\n");
+            continue;
+        }
+        printf("sysfs:   ");
+        print_groups(sysfs_groups, nsysfs);
+
+        int match = ngroups == nsysfs;
+        for (int g = 0; g < ngroups && match; g++) {
+            int found = 0;
+            for (int s = 0; s < nsysfs && !found; s++) {
+                found = memcmp(&groups[g], &sysfs_groups[s], sizeof(cpumask_t)) == 0;
+            }
+            match = found;
+        }
+        printf("%s\n", match ? "matches sysfs" : "DIFFERS from sysfs");
+    }
+
+    restore_affinity(&ctx->opt);
+    return 0;
+}
@@ -0,0 +1,234 @@
+// probe_size.c
+// cache size probe: random pointer chase over growing working sets.
+// latency steps up each time the working set falls out of a cache level.
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "memprobe.h"
+
+// A specific list of sizes to catch the boundaries
+// L1 (32, 48)
+// L2 (1024, 1280, 2048)
+// L3 (12MB - 32MB)
+static const size_t sizes_kb[] = {
+    // L1 Range
+    4, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 128,
+    // L2 Range
+    256, 512, 768, 1024, 1280, 1536, 2048, 3072, 4096,
+    // L3 Range
+    8192, 12288, 16384, 20480, 24576, 28672, 32768, 49152, 65536,
+    0 // Terminator
+};
+
+// adaptive search knobs
+#define MAX_POINTS 256
+#define MAX_EDGES 8
+#define JUMP_RATIO 1.2     // coarse neighbours this far apart straddle an edge
+#define EDGE_FRACTION 0.25 // past this much of the step a size counts as "above"
+
+typedef struct {
+    chase_point_t cp;
+    size_t bytes[MAX_POINTS];
+    stats_t st[MAX_POINTS];
+    int npts;
+    int coarse;            // the first coarse points are the geometric sweep
+} sweep_t;
+
+static void size_setup(void *arg, size_t i) {
+    sweep_t *sw = arg;
+    size_t bytes = sw->bytes[i];
+    sw->cp.head = chain_random(sw->cp.ctx->arena.base, bytes, CACHE_LINE_SIZE);
+    // warm up by touching the whole working set once
+    sw->cp.head = chase(sw->cp.head, bytes / CACHE_LINE_SIZE);
+}
+
+static void size_label(void *arg, size_t i, char *buf, size_t len) {
+    const sweep_t *sw = arg;
+    snprintf(buf, len, "%zu KB", sw->bytes[i] / KB);
+}
+
+static const point_ops_t size_ops = { size_setup, chase_trial, NULL, size_label };
+
+static void sort_points(sweep_t *sw, int n) {
+    // insertion sort, n is tiny
+    for (int i = 1; i < n; i++) {
+        size_t b = sw->bytes[i];
+        stats_t st = sw->st[i];
+        int j = i - 1;
+        for (; j >= 0 && sw->bytes[j] > b; j--) {
+            sw->bytes[j + 1] = sw->bytes[j];
+            sw->st[j + 1] = sw->st[j];
+        }
+        sw->bytes[j + 1] = b;
+        sw->st[j + 1] = st;
+    }
+}
+
+static void print_points(sweep_t *sw, int n) {
+    print_stats_header("Size(KB)");
+    for (int i = 0; i < n; i++) {
+        char label[32];
+        snprintf(label, sizeof(label), "%zu", sw->bytes[i] / KB);
+        print_stats_row(label, &sw->st[i]);
+    }
+}
+
+// sysfs index for the cache whose edge is the n-th transition (L1d, L2, L3)
+static const int edge_sysfs_index[] = { 0, 2, 3 };
+
+// coarse geometric sweep, then bisect only the intervals where latency
+// jumps. a run of jumping neighbours (a slow ramp like L2 -> L3) is merged
+// into one edge. the edge is resolved once the bracket is within
+// precision percent of its lower end. returns the number of edges.
+static int find_edges(probe_ctx_t *ctx, sweep_t *sw, size_t min_bytes, size_t max_bytes,
+                      double precision, cache_edge_t *edges, int max_edges) {
+    point_ops_t ops = size_ops;
+    ops.arg = sw;
+    int npts = 0;
+
+    for (size_t b = min_bytes; b <= max_bytes && npts < MAX_POINTS; b *= 2) {
+        sw->bytes[npts++] = b;
+    }
+    int coarse = npts;
+    measure_points(ctx, coarse, &ops, sw->st);
+
+    int nedges = 0;
+    for (int i = 0; i + 1 < coarse && nedges < max_edges; i++) {
+        if (sw->st[i + 1].median < sw->st[i].median * JUMP_RATIO) continue;
+        edges[nedges].lo = sw->bytes[i];
+        edges[nedges].lo_ns = sw->st[i].median;
+        while (i + 2 < coarse &&
+               sw->st[i + 2].median >= sw->st[i + 1].median * JUMP_RATIO) i++;
+        edges[nedges].hi = sw->bytes[i + 1];
+        edges[nedges].hi_ns = sw->st[i + 1].median;
+        nedges++;
+    }
+
+    for (int e = 0; e < nedges; e++) {
+        // fixed plateau references so the bracket can't drift up the ramp
+        double cut = edges[e].lo_ns + EDGE_FRACTION * (edges[e].hi_ns - edges[e].lo_ns);
+        size_t a = edges[e].lo, b = edges[e].hi;
+
+        while ((double)(b - a) > a * precision / 100.0 && npts < MAX_POINTS) {
+            // geometric midpoint, on a 1 KB grid
+            size_t mid = (size_t)sqrt((double)a * (double)b);
+            mid = (mid + KB / 2) / KB * KB;
+            if (mid <= a || mid >= b) break;
+
+            // a merged ramp can bisect right onto a coarse point, reuse it
+            int k = 0;
+            while (k < npts && sw->bytes[k] != mid) k++;
+            if (k == npts) {
+                char label[32];
+                sw->bytes[npts++] = mid;
+                size_setup(sw, k);
+                size_label(sw, k, label, sizeof(label));
+                measure_point(&ctx->opt, chase_trial, sw, k, label, &sw->st[k]);
+            }
+
+            if (sw->st[k].median < cut) a = mid;
+            else b = mid;
+        }
+        edges[e].lo = a;
+        edges[e].hi = b;
+    }
+
+    sort_points(sw, npts);
+    sw->npts = npts;
+    sw->coarse = coarse;
+    return nedges;
+}
+
+// the size search without the tables, for probes that want measured sizes
+int cache_edges(probe_ctx_t *ctx, size_t min_bytes, size_t max_bytes, double precision,
+                cache_edge_t *edges, int max_edges) {
+    static sweep_t sw;
+    sw.cp.ctx = ctx;
+    if (max_bytes > ctx->arena.size) max_bytes = ctx->arena.size;
+    return find_edges(ctx, &sw, min_bytes, max_bytes, precision, edges, max_edges);
+}
+
+static int search_sizes(probe_ctx_t *ctx, sweep_t *sw, size_t min_bytes,
+                        size_t max_bytes, double precision) {
+    cache_edge_t edges[MAX_EDGES];
+    int nedges = find_edges(ctx, sw, min_bytes, max_bytes, precision, edges, MAX_EDGES);
+    print_points(sw, sw->npts);
+
+    printf("\n%d points (%d coarse, %d refining)\n", sw->npts, sw->coarse,
+           sw->npts - sw->coarse);
+    printf("Level\tEdge(KB)\tLatency(ns)\t\tSysfs(KB)\n");
+    printf("--------------------------------------------------------\n");
+    for (int e = 0; e < nedges; e++) {
+        long sys = -1;
+        if (e < (int)(sizeof(edge_sysfs_index) / sizeof(edge_sysfs_index[0]))) {
+            sys = sysfs_cache_size(ctx->opt.core, edge_sysfs_index[e]);
+        }
+        char sys_kb[32] = "-";
+        if (sys > 0) snprintf(sys_kb, sizeof(sys_kb), "%ld", sys / (long)KB);
+        printf("L%d\t%zu-%zu\t%.2f -> %.2f\t\t%s\n", e + 1,
+               edges[e].lo / KB, edges[e].hi / KB, edges[e].lo_ns, edges[e].hi_ns, sys_kb);
+    }
+    return 0;
+}
+
+int probe_size(probe_ctx_t *ctx, int argc, char **argv) {
+    size_t min_bytes = 4 * KB;
+    size_t max_bytes = 64 * MB;
+    int search = 0;
+    double precision = 5.0;
+
+    static const struct option longopts[] = {
+        { "min",       required_argument, NULL, 'm' },
+        { "max",       required_argument, NULL, 'M' },
+        { "search",    no_argument,       NULL, 's' },
+        { "precision", required_argument, NULL, 'p' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+        case 'm': min_bytes = parse_size(optarg); break;
+        case 'M': max_bytes = parse_size(optarg); break;
+        case 's': search = 1; break;
+        case 'p': precision = atof(optarg); break;
+        default:
+            fprintf(stderr, "Usage: memprobe size [--min=SIZE] [--max=SIZE]"
+                            " [--search [--precision=PCT]]\n");
+            return 1;
+        }
+    }
+    if (max_bytes > ctx->arena.size) max_bytes = ctx->arena.size;
+    if (min_bytes < 2 * CACHE_LINE_SIZE || precision <= 0) {
+        fprintf(stderr, "size: --min must be at least %d bytes, --precision > 0\n",
+                2 * CACHE_LINE_SIZE);
+        return 1;
+    }
+
+    static sweep_t sw;
+    sw.cp.ctx = ctx;
+
+    printf("Cache Size Probe (Random Chase, Defeats Prefetcher)\n");
+    if (search) {
+        printf("Adaptive search, edges to within %.1f%%\n", precision);
+        return search_sizes(ctx, &sw, min_bytes, max_bytes, precision);
+    }
+
+    // walk the table, then keep doubling past its end for big-memory sweeps
+    int npts = 0;
+    size_t bytes = sizes_kb[0] * KB;
+    for (int i = 0; bytes <= max_bytes && npts < MAX_POINTS; ) {
+        if (bytes >= min_bytes) sw.bytes[npts++] = bytes;
+        if (sizes_kb[i] && sizes_kb[i + 1]) bytes = sizes_kb[++i] * KB;
+        else bytes *= 2;
+    }
+
+    point_ops_t ops = size_ops;
+    ops.arg = &sw;
+    measure_points(ctx, npts, &ops, sw.st);
+    print_points(&sw, npts);
+
+    return 0;
+}
@@ -0,0 +1,433 @@
+// probe_store.c
+// store side of the core, on JIT-built loops (jit.c).
+//
+// forwarding: a dependency chain that runs through memory, store the value
+// then load it back, so each round trip costs the store-to-load forwarding
+// latency. the matrix pairs every store size with every load size and moves
+// the load across the stored bytes; a load the store fully contains should
+// forward, one that only partly overlaps it (or is wider) can't and waits
+// for the store to commit to the L1. misaligned, line- and page-splitting
+// pairs come after. 16-byte accesses go through xmm0; where only one side
+// is 16 bytes the chain pays a gpr<->xmm move, measured on its own and
+// taken off.
+//
+// round trips: the data chain above, a chain through the store address
+// instead (the load has to wait for the address to be known), push/pop
+// (cores that rename memory through rsp make it nearly free) and an L1
+// load-use chain with no store at all for scale.
+//
+// store buffer: two independent cache-missing chases with N stores in
+// between. while the N stores fit in the store buffer the second miss issues
+// under the first and a pass costs one miss; once they don't, allocation
+// stalls behind the first miss and a pass costs two. the same with N nops
+// shows the reorder window for comparison.
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memprobe.h"
+
+#define MAX_POINTS 256
+#define MAX_OFFSET 16              // matrix columns, load offset from the store
+#define BUF_PAGES 4                // forwarding buffer / store target, at the arena start
+#define MATRIX_BASE 64             // store offset of the matrix pairs, line aligned
+#define FILL_STEP 4
+#define MAX_FILL 480              // past the reorder buffer of current cores
+#define MISS_REPS 100              // a store-buffer pass costs ~a miss, run fewer of them
+#define STALL_RATIO 1.5            // pass cost over the small-N cost that means a stall
+#define STALL_POINTS 3
+#define CODE_BYTES (64 * KB)
+
+static const int sizes[] = { 1, 2, 4, 8, 16 };
+#define NUM_SIZES ((int)(sizeof(sizes) / sizeof(sizes[0])))
+
+typedef enum {
+    FWD_PAIR,                      // store st bytes, load ld bytes
+    FWD_ADDR,                      // loaded value feeds the next store address
+    FWD_PUSHPOP,
+    FWD_LOAD,                      // L1 load-use, no store
+    FWD_XMM,                       // movq xmm0, rax; movq rax, xmm0
+} fwd_kind_t;
+
+typedef struct {
+    const char *label;
+    fwd_kind_t kind;
+    int st, ld;
+    uint32_t st_off, ld_off;
+} fwd_case_t;
+
+// round trips first, then the misaligned pairs; the matrix follows
+static const fwd_case_t fixed_cases[] = {
+    { "store->load (8 B)", FWD_PAIR, 8, 8, MATRIX_BASE, MATRIX_BASE },
+    { "store addr->load", FWD_ADDR, 0, 0, 0, 0 },
+    { "push/pop", FWD_PUSHPOP, 0, 0, 0, 0 },
+    { "L1 load-use", FWD_LOAD, 0, 0, 0, 0 },
+    { "gpr<->xmm", FWD_XMM, 0, 0, 0, 0 },
+    { "st8 ld8 misaligned", FWD_PAIR, 8, 8, MATRIX_BASE + 3, MATRIX_BASE + 3 },
+    { "st8 ld8 line split", FWD_PAIR, 8, 8, MATRIX_BASE + 60, MATRIX_BASE + 60 },
+    { "st16 ld16 line split", FWD_PAIR, 16, 16, MATRIX_BASE + 56, MATRIX_BASE + 56 },
+    { "st8 ld8 page split", FWD_PAIR, 8, 8, PAGE_SIZE - 4, PAGE_SIZE - 4 },
+    { "st8 ld4 line split", FWD_PAIR, 8, 4, MATRIX_BASE + 60, MATRIX_BASE + 64 },
+};
+#define NUM_FIXED ((size_t)(sizeof(fixed_cases) / sizeof(fixed_cases[0])))
+#define NUM_ROUND_TRIPS 5
+
+typedef void (*buf_fn)(uint64_t reps, char *buf);
+typedef void (*heads_fn)(uint64_t reps, void ***heads, char *buf);
+
+typedef struct {
+    probe_ctx_t *ctx;
+    jit_buf_t jit;
+    char *buf;
+    fwd_case_t cases[MAX_POINTS];
+    size_t ncases;
+    void **heads[2];               // store buffer chases, half a cycle apart
+    size_t fill[MAX_POINTS];
+    size_t nfill;
+    uint64_t reps;
+    int use_heads;
+} store_sweep_t;
+
+// reg 0 (al/ax/eax/rax/xmm0), [rsi + disp32]
+static const unsigned char store_ops[NUM_SIZES][3] = {
+    { 0x88 }, { 0x66, 0x89 }, { 0x89 }, { 0x48, 0x89 }, { 0xf3, 0x0f, 0x7f },
+};
+static const unsigned char load_ops[NUM_SIZES][3] = {
+    { 0x0f, 0xb6 }, { 0x0f, 0xb7 }, { 0x8b }, { 0x48, 0x8b }, { 0xf3, 0x0f, 0x6f },
+};
+static const size_t op_len[NUM_SIZES] = { 1, 2, 1, 2, 3 };
+static const size_t load_op_len[NUM_SIZES] = { 2, 2, 1, 2, 3 };
+
+static const unsigned char movq_to_xmm[] = { 0x66, 0x48, 0x0f, 0x6e, 0xc0 };
+static const unsigned char movq_from_xmm[] = { 0x66, 0x48, 0x0f, 0x7e, 0xc0 };
+
+static int size_index(int bytes) {
+    for (int k = 0; k < NUM_SIZES; k++) {
+        if (sizes[k] == bytes) return k;
+    }
+    return -1;
+}
+
+static unsigned char *emit_rsi_disp32(unsigned char *at, const unsigned char *op, size_t n,
+                                      uint32_t disp) {
+    at = jit_bytes(at, op, n);
+    *at++ = 0x86;                  // mod 10, reg 0, rm rsi
+    memcpy(at, &disp, 4);
+    return at + 4;
+}
+
+static double cycles(double ns) {
+    return ns * timer.core_ghz;
+}
+
+static void fwd_setup(void *arg, size_t i) {
+    store_sweep_t *sw = arg;
+    const fwd_case_t *fc = &sw->cases[i];
+    static const unsigned char prologue[] = {
+        0x31, 0xc0,                // xor eax, eax
+        0x31, 0xc9,                // xor ecx, ecx
+        0x66, 0x0f, 0xef, 0xc0,    // pxor xmm0, xmm0
+    };
+    static const unsigned char addr_body[] = {
+        0x48, 0x89, 0x0c, 0x06,    // mov [rsi + rax], rcx
+        0x48, 0x8b, 0x06,          // mov rax, [rsi]
+    };
+    static const unsigned char pushpop_body[] = { 0x50, 0x58 };
+    static const unsigned char load_body[] = { 0x48, 0x8b, 0x04, 0x06 }; // mov rax, [rsi + rax]
+
+    unsigned char *at = jit_bytes(sw->jit.base, prologue, sizeof(prologue));
+    unsigned char *top = at;
+    switch (fc->kind) {
+    case FWD_PAIR: {
+        int s = size_index(fc->st), l = size_index(fc->ld);
+        // the chain lives in rax, or in xmm0 when both sides are 16 bytes
+        if (fc->st == 16 && fc->ld != 16) at = jit_bytes(at, movq_to_xmm, sizeof(movq_to_xmm));
+        if (fc->st != 16 && fc->ld == 16) {
+            at = jit_bytes(at, movq_from_xmm, sizeof(movq_from_xmm));
+        }
+        at = emit_rsi_disp32(at, store_ops[s], op_len[s], fc->st_off);
+        at = emit_rsi_disp32(at, load_ops[l], load_op_len[l], fc->ld_off);
+        break;
+    }
+    case FWD_ADDR: at = jit_bytes(at, addr_body, sizeof(addr_body)); break;
+    case FWD_PUSHPOP: at = jit_bytes(at, pushpop_body, sizeof(pushpop_body)); break;
+    case FWD_LOAD: at = jit_bytes(at, load_body, sizeof(load_body)); break;
+    case FWD_XMM:
+        at = jit_bytes(at, movq_to_xmm, sizeof(movq_to_xmm));
+        at = jit_bytes(at, movq_from_xmm, sizeof(movq_from_xmm));
+        break;
+    }
+    at = jit_loop_tail(at, top);
+    jit_done(&sw->jit, (size_t)(at - sw->jit.base));
+
+    sw->use_heads = 0;
+    sw->reps = sw->ctx->opt.iterations;
+    ((buf_fn)(void *)sw->jit.base)(sw->reps, sw->buf); // warm up
+}
+
+// store buffer point i: N = fill[i / 2], stores (even i) or nops (odd i)
+static void sb_setup(void *arg, size_t i) {
+    store_sweep_t *sw = arg;
+    size_t n = sw->fill[i / 2];
+    int nops = (int)(i % 2);
+    static const unsigned char prologue[] = {
+        0x4c, 0x8b, 0x06,          // mov r8, [rsi]
+        0x4c, 0x8b, 0x4e, 0x08,    // mov r9, [rsi + 8]
+    };
+    static const unsigned char chase_a[] = { 0x4d, 0x8b, 0x00 }; // mov r8, [r8]
+    static const unsigned char chase_b[] = { 0x4d, 0x8b, 0x09 }; // mov r9, [r9]
+    static const unsigned char epilogue[] = {
+        0x4c, 0x89, 0x06,          // mov [rsi], r8
+        0x4c, 0x89, 0x4e, 0x08,    // mov [rsi + 8], r9
+        0xc3,                      // ret
+    };
+
+    unsigned char *at = jit_bytes(sw->jit.base, prologue, sizeof(prologue));
+    unsigned char *top = at;
+    for (int half = 0; half < 2; half++) {
+        at = jit_bytes(at, half ? chase_b : chase_a, 3);
+        for (size_t k = 0; k < n; k++) {
+            if (nops) {
+                at = jit_nop(at, 1);
+                continue;
+            }
+            // mov [rdx + disp32], eax; every store its own 8 bytes
+            uint32_t disp = (uint32_t)(k * 8 % (BUF_PAGES * PAGE_SIZE));
+            *at++ = 0x89;
+            *at++ = 0x82;
+            memcpy(at, &disp, 4);
+            at += 4;
+        }
+    }
+    at = jit_loop(at, top);
+    at = jit_bytes(at, epilogue, sizeof(epilogue));
+    jit_done(&sw->jit, (size_t)(at - sw->jit.base));
+
+    sw->use_heads = 1;
+    sw->reps = sw->ctx->opt.iterations / MISS_REPS;
+    if (sw->reps == 0) sw->reps = 1;
+    ((heads_fn)(void *)sw->jit.base)(sw->reps / 10 + 1, sw->heads, sw->buf);
+}
+
+static double store_trial(void *arg, size_t i) {
+    store_sweep_t *sw = arg;
+    (void)i;
+
+    counters_begin();
+    uint64_t start = timer_start();
+    if (sw->use_heads) ((heads_fn)(void *)sw->jit.base)(sw->reps, sw->heads, sw->buf);
+    else ((buf_fn)(void *)sw->jit.base)(sw->reps, sw->buf);
+    uint64_t end = timer_stop();
+    counters_end(sw->reps);
+
+    return timer_elapsed_ns(start, end, sw->reps);
+}
+
+static void fwd_label(void *arg, size_t i, char *buf, size_t len) {
+    const store_sweep_t *sw = arg;
+    const fwd_case_t *fc = &sw->cases[i];
+    if (i < NUM_FIXED) snprintf(buf, len, "%s", fc->label);
+    else snprintf(buf, len, "st%d ld%d +%u", fc->st, fc->ld, fc->ld_off - fc->st_off);
+}
+
+static void sb_label(void *arg, size_t i, char *buf, size_t len) {
+    const store_sweep_t *sw = arg;
+    snprintf(buf, len, "sb %zu %s", sw->fill[i / 2], i % 2 ? "nops" : "stores");
+}
+
+// matrix cell: store st, load ld at offset d from it
+static size_t add_matrix(store_sweep_t *sw) {
+    size_t first = sw->ncases;
+    for (int s = 0; s < NUM_SIZES; s++) {
+        for (int l = 0; l < NUM_SIZES; l++) {
+            for (int d = 0; d < sizes[s] && d < MAX_OFFSET; d++) {
+                fwd_case_t *fc = &sw->cases[sw->ncases++];
+                fc->kind = FWD_PAIR;
+                fc->st = sizes[s];
+                fc->ld = sizes[l];
+                fc->st_off = MATRIX_BASE;
+                fc->ld_off = MATRIX_BASE + (uint32_t)d;
+            }
+        }
+    }
+    return first;
+}
+
+static void run_forwarding(store_sweep_t *sw) {
+    memcpy(sw->cases, fixed_cases, sizeof(fixed_cases));
+    sw->ncases = NUM_FIXED;
+    size_t matrix = add_matrix(sw);
+
+    static stats_t st[MAX_POINTS];
+    point_ops_t ops = { fwd_setup, store_trial, sw, fwd_label, "ns/round trip" };
+    measure_points(sw->ctx, sw->ncases, &ops, st);
+
+    double xmm = cycles(st[4].median);
+    printf("\nRound trips (cycles)\n");
+    printf("Chain\t\t\tCycles\n");
+    printf("----------------------------------------\n");
+    for (size_t c = 0; c < NUM_FIXED; c++) {
+        const char *label = sw->cases[c].label;
+        double cy = cycles(st[c].median);
+        if (c >= NUM_ROUND_TRIPS && (sw->cases[c].st == 16) != (sw->cases[c].ld == 16)) {
+            cy -= xmm / 2;
+        }
+        printf("%s\t%s%.2f\n", label, strlen(label) < 16 ? "\t\t" : "\t", cy);
+        if (c + 1 == NUM_ROUND_TRIPS) printf("\n");
+    }
+
+    // forwarded vs stalled: halfway between a byte pulled out of the middle
+    // of an 8-byte store, which has to forward, and a load wider than its
+    // store, which never can. exact same-address pairs can come in far
+    // below both where the core renames memory.
+    double fwd = 0, slow = 0;
+    size_t k = matrix;
+    for (int s = 0; s < NUM_SIZES; s++) {
+        for (int l = 0; l < NUM_SIZES; l++) {
+            if (sizes[s] == 8 && sizes[l] == 1) fwd = cycles(st[k + 1].median);
+            if (sizes[s] == 4 && sizes[l] == 8) slow = cycles(st[k].median);
+            k += (size_t)(sizes[s] < MAX_OFFSET ? sizes[s] : MAX_OFFSET);
+        }
+    }
+    double cut = (fwd + slow) / 2;
+    double fast = cycles(st[0].median);
+
+    printf("\nForwarding matrix (cycles per store + dependent load; columns: load offset "
+           "from the store)\n");
+    printf("St/Ld");
+    for (int d = 0; d < MAX_OFFSET; d++) printf("\t+%d", d);
+    printf("\n------------------------------------------------------------------------"
+           "----------------------------------------------------\n");
+    size_t contained = 0, contained_fwd = 0, partial = 0;
+    double partial_sum = 0;
+    k = matrix;
+    for (int s = 0; s < NUM_SIZES; s++) {
+        for (int l = 0; l < NUM_SIZES; l++) {
+            printf("%d/%d", sizes[s], sizes[l]);
+            for (int d = 0; d < MAX_OFFSET; d++) {
+                if (d >= sizes[s]) {
+                    printf("\t.");
+                    continue;
+                }
+                double cy = cycles(st[k++].median);
+                if ((sizes[s] == 16) != (sizes[l] == 16)) cy -= xmm / 2;
+                if (d + sizes[l] <= sizes[s]) {
+                    contained++;
+                    if (cy < cut) contained_fwd++;
+                } else {
+                    partial++;
+                    partial_sum += cy;
+                }
+                printf("\t%.1f%s", cy, cy < cut ? "" : "*");
+            }
+            printf("\n");
+        }
+    }
+    printf("(* = not forwarded, above %.1f cycles)\n", cut);
+
+    printf("forwarding: %.1f cycles forwarded, %.1f same address and size%s, %.1f L1 load-use, "
+           "%.1f through the store address, %.1f push/pop\n",
+           fwd, fast, fast < fwd / 2 ? " (memory renamed)" : "", cycles(st[3].median),
+           cycles(st[1].median), cycles(st[2].median));
+    printf("forwarding: %zu of %zu loads inside their store forward; partial overlap ~%.1f "
+           "cycles (waits for the store to commit)\n",
+           contained_fwd, contained, partial ? partial_sum / partial : 0);
+    for (size_t c = NUM_ROUND_TRIPS; c < NUM_FIXED; c++) {
+        double cy = cycles(st[c].median);
+        if ((sw->cases[c].st == 16) != (sw->cases[c].ld == 16)) cy -= xmm / 2;
+        printf("forwarding: %s %s (%.1f cycles)\n", sw->cases[c].label,
+               cy < fwd / 2 ? "renamed" : cy < cut ? "forwards" : "stalls", cy);
+    }
+}
+
+static void run_store_buffer(store_sweep_t *sw) {
+    long llc = sysfs_cache_size(sw->ctx->opt.core, 3);
+    if (llc <= 0) llc = 32 * MB;
+    size_t bytes = sw->ctx->arena.size - BUF_PAGES * PAGE_SIZE;
+    if (bytes > 4 * (size_t)llc) bytes = 4 * (size_t)llc;
+    bytes = bytes / PAGE_SIZE * PAGE_SIZE;
+
+    // one cycle, two heads half way round: they advance in lockstep and
+    // never meet
+    void **p = chain_random(sw->buf + BUF_PAGES * PAGE_SIZE, bytes, CACHE_LINE_SIZE);
+    if (!p) return;
+    sw->heads[0] = p;
+    sw->heads[1] = chase(p, bytes / CACHE_LINE_SIZE / 2);
+
+    sw->nfill = 0;
+    for (size_t n = 0; n <= MAX_FILL && 2 * (sw->nfill + 1) <= MAX_POINTS; n += FILL_STEP) {
+        sw->fill[sw->nfill++] = n;
+    }
+    static stats_t st[MAX_POINTS];
+    point_ops_t ops = { sb_setup, store_trial, sw, sb_label, "ns/pass" };
+    measure_points(sw->ctx, 2 * sw->nfill, &ops, st);
+
+    printf("\nStore buffer (ns per pass: two independent misses, N stores or nops after each, "
+           "%zu MB chase)\n", bytes / MB);
+    printf("N\tstores\tnops\n");
+    printf("------------------------\n");
+    for (size_t f = 0; f < sw->nfill; f++) {
+        printf("%zu\t%.1f\t%.1f\n", sw->fill[f], st[2 * f].median, st[2 * f + 1].median);
+    }
+
+    // last N before the pass cost stays above STALL_RATIO x the N = 0 cost
+    // for STALL_POINTS points in a row; one slow point is a VM hiccup
+    const char *what[2] = { "store buffer", "reorder window (nops)" };
+    for (int v = 0; v < 2; v++) {
+        double base = st[(size_t)v].median;
+        size_t stall = 0;
+        for (size_t f = 1; f < sw->nfill && !stall; f++) {
+            size_t run = 0;
+            while (f + run < sw->nfill && run < STALL_POINTS &&
+                   st[2 * (f + run) + (size_t)v].median > STALL_RATIO * base) {
+                run++;
+            }
+            if (run == STALL_POINTS || f + run == sw->nfill) stall = f;
+        }
+        if (stall) {
+            printf("%s: misses overlap with %zu %s in between, not with %zu (%.1f -> %.1f ns)\n",
+                   what[v], sw->fill[stall - 1], v ? "nops" : "stores", sw->fill[stall], base,
+                   st[2 * stall + (size_t)v].median);
+        } else {
+            printf("%s: misses still overlap with %d in between\n", what[v], MAX_FILL);
+        }
+    }
+}
+
+int probe_store(probe_ctx_t *ctx, int argc, char **argv) {
+    const char *tests = "fwd,sb";
+
+    static const struct option longopts[] = {
+        { "tests", required_argument, NULL, 't' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+        case 't': tests = optarg; break;
+        default:
+            fprintf(stderr, "Usage: memprobe store [--tests=fwd,sb]\n");
+            return 1;
+        }
+    }
+    if (ctx->arena.size < (BUF_PAGES + 16) * PAGE_SIZE) {
+        fprintf(stderr, "store: arena too small\n");
+        return 1;
+    }
+
+    static store_sweep_t sw;
+    memset(&sw, 0, sizeof(sw));
+    sw.ctx = ctx;
+    sw.buf = ctx->arena.base;
+    memset(sw.buf, 0, BUF_PAGES * PAGE_SIZE);
+    if (jit_alloc(&sw.jit, CODE_BYTES) != 0) return 1;
+
+    printf("Store Probe (cycles at %.2f GHz)\n", timer.core_ghz);
+    if (strstr(tests, "fwd")) run_forwarding(&sw);
+    if (strstr(tests, "sb")) run_store_buffer(&sw);
+
+    jit_free(&sw.jit);
+    return 0;
+}
@@ -0,0 +1,77 @@
+// probe_tlb.c
+// TLB probe: one node per page, so every access touches a different virtual
+// page. when the page count passes a TLB level's reach, latency steps up.
+// the default seq mode links page i to i+1 at offset 0, which puts every
+// node in one L1D set and lets the prefetcher walk ahead. --mode=rotate
+// visits the pages in random order and moves the node one line further
+// into each page, so the steps are the dTLB and STLB rather than L1D ways.
+#include <getopt.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "memprobe.h"
+
+static const int test_counts[] = {
+    8, 16, 32, 48, 64, 72, 96, 128,
+    256, 512, 1024, 1500, 1536, 1600,
+    2000, 2048, 2100, 2500, 3072, 4096, 8192, 0
+};
+
+static int rotate;
+
+static void tlb_setup(void *arg, size_t i) {
+    chase_point_t *cp = arg;
+    size_t entries = test_counts[i];
+    if (rotate) cp->head = chain_pages(cp->ctx->arena.base, entries, PAGE_SIZE);
+    else cp->head = chain_strided(cp->ctx->arena.base, entries, PAGE_SIZE);
+    cp->head = chase(cp->head, entries);
+}
+
+static void tlb_label(void *arg, size_t i, char *buf, size_t len) {
+    (void)arg;
+    snprintf(buf, len, "%s %d pages", rotate ? "rotate" : "seq", test_counts[i]);
+}
+
+int probe_tlb(probe_ctx_t *ctx, int argc, char **argv) {
+    const char *mode = "seq";
+
+    static const struct option longopts[] = {
+        { "mode", required_argument, NULL, 'm' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+        case 'm': mode = optarg; break;
+        default:
+            fprintf(stderr, "Usage: memprobe tlb [--mode=seq|rotate]\n");
+            return 1;
+        }
+    }
+    rotate = strcmp(mode, "rotate") == 0;
+    if (!rotate && strcmp(mode, "seq") != 0) {
+        fprintf(stderr, "tlb: unknown mode '%s'\n", mode);
+        return 1;
+    }
+
+    if (rotate) printf("TLB Probe (Random Page Order, Rotating Line Offset)\n");
+    else printf("TLB Probe (Stride = %d B)\n", PAGE_SIZE);
+
+    size_t n = 0;
+    while (test_counts[n] != 0 && (size_t)test_counts[n] * PAGE_SIZE <= ctx->arena.size) n++;
+
+    chase_point_t cp = { ctx, NULL };
+    point_ops_t ops = { tlb_setup, chase_trial, &cp, tlb_label };
+    stats_t st[sizeof(test_counts) / sizeof(test_counts[0])];
+    measure_points(ctx, n, &ops, st);
+
+    print_stats_header("Entries");
+    for (size_t i = 0; i < n; i++) {
+        char label[32];
+        snprintf(label, sizeof(label), "%d", test_counts[i]);
+        print_stats_row(label, &st[i]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,318 @@
+// probe_walk.c
+// page walk cost per paging level. every node sits on its own virtual page,
+// far more pages than the STLB holds, so every hop walks. how far apart the
+// pages are decides how much of the walk the paging-structure caches can
+// skip: pages packed into a few page tables only fetch the PTE, pages 2M
+// apart need a new PDE every hop, 1G apart a new PDPTE, 512G apart a new
+// PML4E (and 256T apart a PML5E with 5-level paging). each row minus the
+// one above is what that level adds to a walk.
+//
+// physical memory stays tiny: all virtual pages map the same small memfd,
+// and node j uses line j of it, so the data itself always hits in L1/L2
+// and only translation changes between rows. with 2M/1G pages the memfd is
+// hugetlbfs and needs one free huge page of that size.
+#define _GNU_SOURCE
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "memprobe.h"
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+#ifndef MFD_HUGETLB
+#define MFD_HUGETLB 0x0004U
+#endif
+#ifndef MFD_HUGE_2MB
+#define MFD_HUGE_2MB (21U << 26)
+#endif
+#ifndef MFD_HUGE_1GB
+#define MFD_HUGE_1GB (30U << 26)
+#endif
+
+#define DEFAULT_NODES 8192
+#define MAX_NODES 65536
+#define HIT_NODES 16           // few enough to stay in the L1 dTLB
+#define MAP_HEADROOM 256       // mappings left for libc, the arena, perf...
+#define WALK_BASE (1ULL << 40) // PML4 slot 2, clear of the binary and heap
+#define PML4_SLOTS 192         // 96T of the 128T user half
+#define PML5_SLOTS 64
+
+typedef struct {
+    const char *name;
+    int shift;
+} level_t;
+
+// consecutive nodes differ in this level's entry
+static const level_t levels[] = {
+    { "pde",   21 },
+    { "pdpte", 30 },
+    { "pml4e", 39 },
+    { "pml5e", 48 },
+};
+#define NUM_LEVELS ((int)(sizeof(levels) / sizeof(levels[0])))
+
+typedef struct {
+    const char *name;
+    int shift;
+    unsigned mfd_flags;
+} page_cfg_t;
+
+static const page_cfg_t page_cfgs[] = {
+    { "4k", 12, 0 },
+    { "2m", 21, MFD_HUGETLB | MFD_HUGE_2MB },
+    { "1g", 30, MFD_HUGETLB | MFD_HUGE_1GB },
+};
+
+typedef struct {
+    chase_point_t cp;
+    const page_cfg_t *page;
+    int fd;
+    size_t nodes;
+    size_t mapped;             // pages currently mapped
+    int shift[2 + NUM_LEVELS]; // per point: span shift, 0 for the TLB-hit row
+    char **node;
+    size_t *next;
+} walk_sweep_t;
+
+// every node is its own mapping, so vm.max_map_count (65530 by default)
+// caps the node count, less what the process has mapped already
+static size_t map_limit(void) {
+    size_t limit = MAX_NODES;
+    FILE *f = fopen("/proc/sys/vm/max_map_count", "r");
+    if (!f) return limit;
+    long max = 0;
+    if (fscanf(f, "%ld", &max) != 1) max = 0;
+    fclose(f);
+
+    long used = 0;
+    f = fopen("/proc/self/maps", "r");
+    if (f) {
+        char line[512];
+        while (fgets(line, sizeof(line), f)) {
+            if (strchr(line, '\n')) used++;
+        }
+        fclose(f);
+    }
+    long room = max - used - MAP_HEADROOM;
+    if (max > 0 && room < (long)limit) limit = room > 0 ? (size_t)room : 0;
+    return limit;
+}
+
+static int la57_enabled(void) {
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (!f) return 0;
+    char line[4096];
+    int found = 0;
+    while (!found && fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "flags", 5) == 0) found = strstr(line, " la57") != NULL;
+    }
+    fclose(f);
+    return found;
+}
+
+// virtual page of node j when consecutive nodes should differ at level shift.
+// below PML4 there's room to put every node in its own entry; at the top
+// levels there are only a few hundred entries, so nodes cycle through them
+// and step by 1G within each.
+static uintptr_t node_page(int shift, size_t j) {
+    if (shift <= 30) return WALK_BASE + ((uintptr_t)j << shift);
+    size_t slots = shift == 39 ? PML4_SLOTS : PML5_SLOTS;
+    uintptr_t base = shift == 39 ? WALK_BASE : 1ULL << 48;
+    return base + ((uintptr_t)(j % slots) << shift) + ((uintptr_t)(j / slots) << 30);
+}
+
+static void walk_unmap(walk_sweep_t *sw) {
+    size_t page = 1ULL << sw->page->shift;
+    for (size_t j = 0; j < sw->mapped; j++) {
+        uintptr_t va = (uintptr_t)sw->node[j] & ~(uintptr_t)(page - 1);
+        munmap((void *)va, page);
+    }
+    sw->mapped = 0;
+}
+
+// map count pages spread at the given shift, each onto the memfd page that
+// holds its node's line, and link them in one random cycle
+static int walk_map(walk_sweep_t *sw, size_t count, int shift) {
+    size_t page = 1ULL << sw->page->shift;
+    for (size_t j = 0; j < count; j++) {
+        uintptr_t va = node_page(shift, j);
+        size_t off = j * CACHE_LINE_SIZE;
+        void *p = mmap((void *)va, page, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_FIXED_NOREPLACE, sw->fd, off / page * page);
+        if (p == MAP_FAILED || (uintptr_t)p != va) {
+            if (p != MAP_FAILED) munmap(p, page);
+            return -1;
+        }
+        sw->node[j] = (char *)p + off % page;
+        sw->mapped = j + 1;
+    }
+
+    for (size_t j = 0; j < count; j++) sw->next[j] = j;
+    for (size_t i = count - 1; i > 0; i--) {
+        size_t k = (size_t)(chain_rand() % i);
+        size_t temp = sw->next[i];
+        sw->next[i] = sw->next[k];
+        sw->next[k] = temp;
+    }
+    for (size_t j = 0; j < count; j++) *(void **)sw->node[j] = sw->node[sw->next[j]];
+    return 0;
+}
+
+static void walk_setup(void *arg, size_t i) {
+    walk_sweep_t *sw = arg;
+    int shift = sw->shift[i];
+    size_t count = shift ? sw->nodes : HIT_NODES;
+
+    walk_unmap(sw);
+    if (walk_map(sw, count, shift ? shift : sw->page->shift) != 0) {
+        // no chain, walk_trial skips this row
+        fprintf(stderr, "walk: mapping %s pages 2^%d apart failed: %s\n",
+                sw->page->name, shift, strerror(errno));
+        walk_unmap(sw);
+        sw->cp.head = NULL;
+        return;
+    }
+    sw->cp.head = (void **)sw->node[0];
+    sw->cp.head = chase(sw->cp.head, count * 2);
+}
+
+static double walk_trial(void *arg, size_t i) {
+    walk_sweep_t *sw = arg;
+    if (!sw->cp.head) return -1.0;
+    return chase_trial(arg, i);
+}
+
+static const char *row_name(const walk_sweep_t *sw, int shift) {
+    if (shift == 0) return "tlb hit";
+    if (shift == sw->page->shift) return "stlb miss";
+    for (int l = 0; l < NUM_LEVELS; l++) {
+        if (levels[l].shift == shift) return levels[l].name;
+    }
+    return "?";
+}
+
+static void walk_label(void *arg, size_t i, char *buf, size_t len) {
+    const walk_sweep_t *sw = arg;
+    snprintf(buf, len, "%s %s", sw->page->name, row_name(sw, sw->shift[i]));
+}
+
+int probe_walk(probe_ctx_t *ctx, int argc, char **argv) {
+    size_t nodes = DEFAULT_NODES;
+    const char *sizes = "4k,2m,1g";
+
+    static const struct option longopts[] = {
+        { "nodes", required_argument, NULL, 'n' },
+        { "sizes", required_argument, NULL, 'z' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+        case 'n': nodes = parse_size(optarg); break;
+        case 'z': sizes = optarg; break;
+        default:
+            fprintf(stderr, "Usage: memprobe walk [--nodes=N] [--sizes=4k,2m,1g]\n");
+            return 1;
+        }
+    }
+    size_t max_nodes = map_limit();
+    if (nodes < 2 * HIT_NODES || nodes > max_nodes) {
+        fprintf(stderr, "walk: --nodes must be %d..%zu (vm.max_map_count)\n", 2 * HIT_NODES,
+                max_nodes);
+        return 1;
+    }
+
+    int la57 = la57_enabled();
+    printf("Page Walk Probe (%zu pages per row, random order)\n", nodes);
+    printf("paging: %d-level, hypervisor: %s\n", la57 ? 5 : 4,
+           under_hypervisor() ? "yes (walks are two-dimensional, guest x EPT/NPT)" : "no");
+    printf("rows: pages far enough apart that the named entry differs every hop\n");
+
+    static walk_sweep_t sw;
+    sw.cp.ctx = ctx;
+    sw.nodes = nodes;
+    sw.node = malloc(nodes * sizeof(char *));
+    sw.next = malloc(nodes * sizeof(size_t));
+    if (!sw.node || !sw.next) {
+        perror("malloc");
+        free(sw.node);
+        free(sw.next);
+        return 1;
+    }
+
+    for (size_t p = 0; p < sizeof(page_cfgs) / sizeof(page_cfgs[0]); p++) {
+        const page_cfg_t *cfg = &page_cfgs[p];
+        if (!strstr(sizes, cfg->name)) continue;
+
+        size_t page = 1ULL << cfg->shift;
+        size_t backing = (nodes * CACHE_LINE_SIZE + page - 1) / page * page;
+        // hugetlbfs only reserves the page at mmap time, so map it once up front
+        int fd = memfd_create("memprobe-walk", MFD_CLOEXEC | cfg->mfd_flags);
+        void *probe_map = MAP_FAILED;
+        if (fd >= 0 && ftruncate(fd, backing) == 0) {
+            probe_map = mmap(NULL, backing, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        if (probe_map != MAP_FAILED) munmap(probe_map, backing);
+        if (probe_map == MAP_FAILED) {
+            printf("\n%s pages: no backing (%s)%s\n", cfg->name, strerror(errno),
+                   cfg->mfd_flags ? ", reserve a huge page in nr_hugepages" : "");
+            if (fd >= 0) close(fd);
+            continue;
+        }
+        sw.page = cfg;
+        sw.fd = fd;
+        sw.mapped = 0;
+
+        // tlb hit, stlb miss (walk served by the deepest cache), then one
+        // row per level above the leaf
+        size_t n = 0;
+        sw.shift[n++] = 0;
+        sw.shift[n++] = cfg->shift;
+        for (int l = 0; l < NUM_LEVELS; l++) {
+            if (levels[l].shift <= cfg->shift) continue;
+            if (levels[l].shift == 48 && !la57) continue;
+            sw.shift[n++] = levels[l].shift;
+        }
+
+        stats_t st[2 + NUM_LEVELS];
+        point_ops_t ops = { walk_setup, walk_trial, &sw, walk_label };
+        measure_points(ctx, n, &ops, st);
+        walk_unmap(&sw);
+        close(fd);
+
+        printf("\n%s pages\n", cfg->name);
+        print_stats_header("Row");
+        for (size_t i = 0; i < n; i++) {
+            if (st[i].trials) print_stats_row(row_name(&sw, sw.shift[i]), &st[i]);
+            else printf("%s\t\tnot mapped\n", row_name(&sw, sw.shift[i]));
+        }
+
+        // each level against the last row that did map
+        printf("walk cost (%s):", cfg->name);
+        size_t prev = 0, last = 0;
+        for (size_t i = 1; i < n; i++) {
+            if (!st[i].trials) continue;
+            if (st[prev].trials) {
+                printf(" %s %+.1f ns", row_name(&sw, sw.shift[i]),
+                       st[i].median - st[prev].median);
+            }
+            prev = last = i;
+        }
+        if (st[0].trials && last > 0) {
+            printf(", full walk %.1f ns\n", st[last].median - st[0].median);
+        } else {
+            printf(" n/a\n");
+        }
+    }
+
+    free(sw.node);
+    free(sw.next);
+    return 0;
+}
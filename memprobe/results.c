@@ -0,0 +1,612 @@
+// results.c
+// machine-readable results. with --json/--csv every point that goes through
+// measure_point() or measure_points() is kept under the probe that ran it,
+// and at exit the lot is written out with a fingerprint of the machine it
+// ran on (cpu model, microcode, kernel, core, page mode, timer). "memprobe
+// compare" reads two such files back and flags the points that moved by
+// more than their noise.
+//
+// a point's key is probe, core type (--per-type only) and the label the
+// probe gave it ("4096 KB", "btb 1024 x 64 B"), so points line up across
+// runs with different option subsets. every value is ns per something; the
+// unit says per what ("ns/access", "ns/byte", "ns/jump"). structural
+// results that aren't ns (evset's set sizes and slice hash, share's groups)
+// are only printed.
+#define _GNU_SOURCE
+#include <cpuid.h>
+#include <getopt.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/utsname.h>
+#include <time.h>
+
+#include "memprobe.h"
+
+#define MAX_FIELDS 32
+#define FIELD_LEN 256
+#define LINE_LEN 4096
+#define KEY_LEN 192
+#define DEFAULT_THRESHOLD 5.0      // % change a significant point needs to be flagged
+
+typedef struct {
+    char probe[32];
+    char variant[48];              // core type under --per-type, else empty
+    char label[96];
+    char unit[24];
+    stats_t st;
+} result_t;
+
+// machine fingerprint, in the order it is written
+typedef struct {
+    char key[MAX_FIELDS][32];
+    char value[MAX_FIELDS][FIELD_LEN];
+    int n;
+} fingerprint_t;
+
+static struct {
+    int on;
+    result_t *v;
+    size_t n, cap;
+    char probe[32];
+    char variant[48];
+    int sweep;                     // measure_points() calls in this probe so far
+    fingerprint_t fp;
+} res;
+
+static void fp_set(fingerprint_t *fp, const char *key, const char *fmt, ...) {
+    if (fp->n == MAX_FIELDS) return;
+    snprintf(fp->key[fp->n], sizeof(fp->key[0]), "%s", key);
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(fp->value[fp->n], sizeof(fp->value[0]), fmt, ap);
+    va_end(ap);
+    fp->n++;
+}
+
+static const char *fp_get(const fingerprint_t *fp, const char *key) {
+    for (int k = 0; k < fp->n; k++) {
+        if (strcmp(fp->key[k], key) == 0) return fp->value[k];
+    }
+    return NULL;
+}
+
+// "microcode\t: 0xa601206" of the cpu we're on, or the first one listed
+static void read_microcode(int cpu, char *out, size_t len) {
+    snprintf(out, len, "unknown");
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (!f) return;
+    char line[512];
+    int current = -1, found = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "processor", 9) == 0) {
+            char *colon = strchr(line, ':');
+            current = colon ? atoi(colon + 1) : -1;
+        } else if (strncmp(line, "microcode", 9) == 0 && (current == cpu || !found)) {
+            char *colon = strchr(line, ':');
+            if (!colon) continue;
+            colon++;
+            while (*colon == ' ') colon++;
+            colon[strcspn(colon, "\n")] = '\0';
+            snprintf(out, len, "%s", colon);
+            found = 1;
+            if (current == cpu) break;
+        }
+    }
+    fclose(f);
+}
+
+void results_enable(void) {
+    res.on = 1;
+}
+
+// what the results were measured on. called once the core is pinned, the
+// timer calibrated and the arena mapped.
+void results_fingerprint(const probe_ctx_t *ctx, int argc, char **argv) {
+    fingerprint_t *fp = &res.fp;
+    unsigned a, b, c, d;
+
+    char vendor[13] = "unknown";
+    char brand[49] = "unknown";
+    if (__get_cpuid(0, &a, &b, &c, &d)) {
+        memcpy(vendor, &b, 4);
+        memcpy(vendor + 4, &d, 4);
+        memcpy(vendor + 8, &c, 4);
+        vendor[12] = '\0';
+    }
+    if (__get_cpuid(0x80000000, &a, &b, &c, &d) && a >= 0x80000004) {
+        unsigned *w = (unsigned *)brand;
+        for (unsigned leaf = 0; leaf < 3; leaf++) {
+            __get_cpuid(0x80000002 + leaf, &w[leaf * 4], &w[leaf * 4 + 1], &w[leaf * 4 + 2],
+                        &w[leaf * 4 + 3]);
+        }
+        brand[48] = '\0';
+    }
+    char *p = brand;
+    while (*p == ' ') p++;
+    fp_set(fp, "cpu", "%s", p);
+    fp_set(fp, "vendor", "%s", vendor);
+
+    // family and model with the extended fields folded in, as the SDM says
+    unsigned family = 0, model = 0, stepping = 0;
+    if (__get_cpuid(1, &a, &b, &c, &d)) {
+        family = (a >> 8) & 0xf;
+        model = (a >> 4) & 0xf;
+        stepping = a & 0xf;
+        if (family == 0xf) family += (a >> 20) & 0xff;
+        if (family >= 0x6) model |= ((a >> 16) & 0xf) << 4;
+    }
+    fp_set(fp, "family", "0x%x", family);
+    fp_set(fp, "model", "0x%x", model);
+    fp_set(fp, "stepping", "%u", stepping);
+
+    int cpu = sched_getcpu();
+    char microcode[64];
+    read_microcode(cpu, microcode, sizeof(microcode));
+    fp_set(fp, "microcode", "%s", microcode);
+
+    struct utsname u;
+    if (uname(&u) == 0) {
+        fp_set(fp, "kernel", "%s", u.release);
+        fp_set(fp, "kernel_build", "%s", u.version);
+        fp_set(fp, "host", "%s", u.nodename);
+    }
+    if (ctx->opt.core >= 0) fp_set(fp, "core", "%d", ctx->opt.core);
+    else fp_set(fp, "core", "unpinned (ran on %d)", cpu);
+    fp_set(fp, "pages", "%s", pages_name(ctx->arena.pages));
+    fp_set(fp, "huge_mb", "%zu", ctx->arena.huge_bytes / MB);
+    fp_set(fp, "arena_mb", "%zu", ctx->arena.size / MB);
+    fp_set(fp, "timer", "%s", timer_name());
+    fp_set(fp, "tsc_ghz", "%.3f", timer.kind == TIMER_TSC ? timer.ticks_per_ns : 0.0);
+    fp_set(fp, "core_ghz", "%.3f", timer.core_ghz);
+    fp_set(fp, "iterations", "%zu", ctx->opt.iterations);
+    fp_set(fp, "trials", "%d-%d", ctx->opt.min_trials, ctx->opt.max_trials);
+    fp_set(fp, "ci_pct", "%g", ctx->opt.ci_target);
+    fp_set(fp, "seed", "%llu", (unsigned long long)ctx->opt.seed);
+
+    time_t now = time(NULL);
+    struct tm tm;
+    char date[32];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime_r(&now, &tm));
+    fp_set(fp, "date", "%s", date);
+
+    char cmd[FIELD_LEN] = "memprobe";
+    for (int k = 1; k < argc; k++) {
+        size_t used = strlen(cmd);
+        snprintf(cmd + used, sizeof(cmd) - used, " %s", argv[k]);
+    }
+    fp_set(fp, "command", "%s", cmd);
+}
+
+void results_probe(const char *probe) {
+    snprintf(res.probe, sizeof(res.probe), "%s", probe);
+    res.sweep = 0;
+}
+
+void results_variant(const char *variant) {
+    snprintf(res.variant, sizeof(res.variant), "%s", variant ? variant : "");
+}
+
+int results_sweep(void) {
+    return res.sweep++;
+}
+
+// unit NULL: ns per access, what the chase probes measure
+void results_add(const char *label, const char *unit, const stats_t *st) {
+    if (!res.on) return;
+    if (res.n == res.cap) {
+        size_t cap = res.cap ? 2 * res.cap : 256;
+        result_t *v = realloc(res.v, cap * sizeof(result_t));
+        if (!v) return;
+        res.v = v;
+        res.cap = cap;
+    }
+    result_t *r = &res.v[res.n++];
+    snprintf(r->probe, sizeof(r->probe), "%s", res.probe);
+    snprintf(r->variant, sizeof(r->variant), "%s", res.variant);
+    snprintf(r->label, sizeof(r->label), "%s", label);
+    snprintf(r->unit, sizeof(r->unit), "%s", unit ? unit : "ns/access");
+    r->st = *st;
+}
+
+static void json_string(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fprintf(f, "\\%c", *s);
+        else if ((unsigned char)*s < 0x20) fprintf(f, "\\u%04x", *s);
+        else fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+// one result per line, so compare can read it back a line at a time
+static int write_json(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    fprintf(f, "{\n  \"memprobe_results\": 1,\n  \"fingerprint\": {\n");
+    for (int k = 0; k < res.fp.n; k++) {
+        fprintf(f, "    ");
+        json_string(f, res.fp.key[k]);
+        fprintf(f, ": ");
+        json_string(f, res.fp.value[k]);
+        fprintf(f, "%s\n", k + 1 < res.fp.n ? "," : "");
+    }
+    fprintf(f, "  },\n  \"results\": [\n");
+    for (size_t k = 0; k < res.n; k++) {
+        const result_t *r = &res.v[k];
+        fprintf(f, "    {\"probe\": ");
+        json_string(f, r->probe);
+        fprintf(f, ", \"variant\": ");
+        json_string(f, r->variant);
+        fprintf(f, ", \"label\": ");
+        json_string(f, r->label);
+        fprintf(f, ", \"unit\": ");
+        json_string(f, r->unit);
+        fprintf(f, ", \"median\": %.6g, \"mean\": %.6g, \"p5\": %.6g, "
+                   "\"p95\": %.6g, \"ci_lo\": %.6g, \"ci_hi\": %.6g, \"trials\": %d}%s\n",
+                r->st.median, r->st.mean, r->st.p5, r->st.p95, r->st.ci_lo, r->st.ci_hi,
+                r->st.trials, k + 1 < res.n ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+static void csv_field(FILE *f, const char *s) {
+    if (!strpbrk(s, ",\"\n")) {
+        fputs(s, f);
+        return;
+    }
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"') fputc('"', f);
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+// fingerprint as "# key: value" comment lines above the header
+static int write_csv(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    fprintf(f, "# memprobe_results: 1\n");
+    for (int k = 0; k < res.fp.n; k++) fprintf(f, "# %s: %s\n", res.fp.key[k], res.fp.value[k]);
+    fprintf(f, "probe,variant,label,unit,median,mean,p5,p95,ci_lo,ci_hi,trials\n");
+    for (size_t k = 0; k < res.n; k++) {
+        const result_t *r = &res.v[k];
+        csv_field(f, r->probe);
+        fputc(',', f);
+        csv_field(f, r->variant);
+        fputc(',', f);
+        csv_field(f, r->label);
+        fputc(',', f);
+        csv_field(f, r->unit);
+        fprintf(f, ",%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,%d\n", r->st.median, r->st.mean,
+                r->st.p5, r->st.p95, r->st.ci_lo, r->st.ci_hi, r->st.trials);
+    }
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+int results_write(const char *json_path, const char *csv_path) {
+    int rc = 0;
+    if (json_path && write_json(json_path) != 0) rc = -1;
+    if (csv_path && write_csv(csv_path) != 0) rc = -1;
+    free(res.v);
+    res.v = NULL;
+    res.n = res.cap = 0;
+    return rc;
+}
+
+// reading results back for compare
+
+typedef struct {
+    char key[KEY_LEN];             // probe/variant/label
+    char unit[24];
+    double median, ci_lo, ci_hi;
+    int trials;
+} point_t;
+
+typedef struct {
+    const char *path;
+    fingerprint_t fp;
+    point_t *v;
+    size_t n, cap;
+} run_t;
+
+static int add_point(run_t *run, const char *probe, const char *variant, const char *label,
+                     const char *unit, double median, double ci_lo, double ci_hi, int trials) {
+    if (run->n == run->cap) {
+        size_t cap = run->cap ? 2 * run->cap : 256;
+        point_t *v = realloc(run->v, cap * sizeof(point_t));
+        if (!v) return -1;
+        run->v = v;
+        run->cap = cap;
+    }
+    point_t *pt = &run->v[run->n++];
+    if (*variant) snprintf(pt->key, sizeof(pt->key), "%s@%s/%s", probe, variant, label);
+    else snprintf(pt->key, sizeof(pt->key), "%s/%s", probe, label);
+    snprintf(pt->unit, sizeof(pt->unit), "%s", unit);
+    pt->median = median;
+    pt->ci_lo = ci_lo;
+    pt->ci_hi = ci_hi;
+    pt->trials = trials;
+    return 0;
+}
+
+// a JSON string starting at the opening quote; returns past the closing one
+static const char *json_unquote(const char *s, char *out, size_t len) {
+    size_t n = 0;
+    if (*s != '"') return NULL;
+    for (s++; *s && *s != '"'; s++) {
+        char ch = *s;
+        if (ch == '\\' && s[1]) {
+            s++;
+            ch = *s;
+            if (ch == 'u') {
+                ch = (char)strtol(s + 1, NULL, 16);
+                s += 4;
+            }
+        }
+        if (n + 1 < len) out[n++] = ch;
+    }
+    out[n] = '\0';
+    return *s == '"' ? s + 1 : NULL;
+}
+
+// value of "key" in a one-line object of our own making
+static int json_get(const char *line, const char *key, char *out, size_t len) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+    const char *p = strstr(line, pattern);
+    if (!p) return -1;
+    p += strlen(pattern);
+    if (*p == '"') return json_unquote(p, out, len) ? 0 : -1;
+    size_t n = strcspn(p, ",}\n");
+    if (n >= len) n = len - 1;
+    memcpy(out, p, n);
+    out[n] = '\0';
+    return 0;
+}
+
+static int load_json(FILE *f, run_t *run) {
+    char line[LINE_LEN];
+    int in_fp = 0;
+    while (fgets(line, sizeof(line), f)) {
+        const char *p = line + strspn(line, " ");
+        if (strncmp(p, "\"fingerprint\"", 13) == 0) {
+            in_fp = 1;
+        } else if (in_fp && *p == '}') {
+            in_fp = 0;
+        } else if (in_fp && *p == '"' && run->fp.n < MAX_FIELDS) {
+            fingerprint_t *fp = &run->fp;
+            const char *v = json_unquote(p, fp->key[fp->n], sizeof(fp->key[0]));
+            if (v && (v = strchr(v, '"')) && json_unquote(v, fp->value[fp->n], FIELD_LEN)) fp->n++;
+        } else if (strncmp(p, "{\"probe\"", 8) == 0) {
+            char probe[32], variant[48], label[96], unit[24], median[32], lo[32], hi[32];
+            char trials[16];
+            if (json_get(p, "probe", probe, sizeof(probe)) ||
+                json_get(p, "variant", variant, sizeof(variant)) ||
+                json_get(p, "label", label, sizeof(label)) ||
+                json_get(p, "unit", unit, sizeof(unit)) ||
+                json_get(p, "median", median, sizeof(median)) ||
+                json_get(p, "ci_lo", lo, sizeof(lo)) || json_get(p, "ci_hi", hi, sizeof(hi)) ||
+                json_get(p, "trials", trials, sizeof(trials))) {
+                continue;
+            }
+            if (add_point(run, probe, variant, label, unit, atof(median), atof(lo), atof(hi),
+                          atoi(trials)) != 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+// split one CSV line in place; quoted fields may hold commas and ""
+static int csv_split(char *line, char **fields, int max) {
+    int n = 0;
+    char *p = line;
+    line[strcspn(line, "\r\n")] = '\0';
+    while (n < max) {
+        char *out = p;
+        fields[n++] = p;
+        if (*p == '"') {
+            char *in = p + 1;
+            for (;;) {
+                if (*in == '\0') break;
+                if (*in == '"' && in[1] == '"') {
+                    *out++ = '"';
+                    in += 2;
+                } else if (*in == '"') {
+                    in++;
+                    break;
+                } else {
+                    *out++ = *in++;
+                }
+            }
+            p = in;
+        } else {
+            while (*p && *p != ',') p++;
+            out = p;
+        }
+        int more = *p == ',';
+        *out = '\0';
+        if (!more) break;
+        p++;
+    }
+    return n;
+}
+
+static int load_csv(FILE *f, run_t *run) {
+    char line[LINE_LEN];
+    int header = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#') {
+            char *colon = strstr(line, ": ");
+            if (!colon || run->fp.n == MAX_FIELDS || strncmp(line, "# memprobe_results", 18) == 0) {
+                continue;
+            }
+            *colon = '\0';
+            colon[2 + strcspn(colon + 2, "\n")] = '\0';
+            snprintf(run->fp.key[run->fp.n], sizeof(run->fp.key[0]), "%.31s", line + 2);
+            snprintf(run->fp.value[run->fp.n], FIELD_LEN, "%s", colon + 2);
+            run->fp.n++;
+            continue;
+        }
+        if (!header) {
+            header = 1;
+            continue;
+        }
+        char *fld[11];
+        if (csv_split(line, fld, 11) != 11) continue;
+        if (add_point(run, fld[0], fld[1], fld[2], fld[3], atof(fld[4]), atof(fld[8]),
+                      atof(fld[9]), atoi(fld[10])) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int cmp_point(const void *a, const void *b) {
+    return strcmp(((const point_t *)a)->key, ((const point_t *)b)->key);
+}
+
+// JSON or CSV, whichever the file turns out to be
+static int load_run(const char *path, run_t *run) {
+    memset(run, 0, sizeof(*run));
+    run->path = path;
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    int first = fgetc(f);
+    rewind(f);
+    int rc = first == '{' ? load_json(f, run) : load_csv(f, run);
+    fclose(f);
+    if (rc == 0 && run->n == 0) {
+        fprintf(stderr, "compare: no results in %s\n", path);
+        rc = -1;
+    }
+    if (rc == 0) qsort(run->v, run->n, sizeof(point_t), cmp_point);
+    return rc;
+}
+
+static void describe_run(const char *what, const run_t *run) {
+    const char *cpu = fp_get(&run->fp, "cpu"), *kernel = fp_get(&run->fp, "kernel");
+    const char *date = fp_get(&run->fp, "date");
+    printf("%s: %s (%s, %s, kernel %s)\n", what, run->path, date ? date : "no date",
+           cpu ? cpu : "unknown cpu", kernel ? kernel : "unknown");
+}
+
+// usage: compare [--threshold=PCT] BASELINE NEW
+// a point counts as changed when the 95% CIs of the two medians don't
+// overlap and the medians are more than PCT apart. every value is time per
+// operation (bandwidth probes report ns per byte), so up is slower. a point
+// whose unit changed between the runs isn't compared.
+int results_compare(int argc, char **argv, int verbose) {
+    double threshold = DEFAULT_THRESHOLD;
+
+    static const struct option longopts[] = {
+        { "threshold", required_argument, NULL, 't' },
+        { NULL, 0, NULL, 0 }
+    };
+    int c;
+    optind = 0;
+    while ((c = getopt_long(argc, argv, "", longopts, NULL)) != -1) {
+        switch (c) {
+        case 't': threshold = atof(optarg); break;
+        default:
+            fprintf(stderr, "Usage: memprobe compare [--threshold=PCT] BASELINE NEW\n");
+            return 1;
+        }
+    }
+    if (argc - optind != 2 || threshold < 0) {
+        fprintf(stderr, "Usage: memprobe compare [--threshold=PCT] BASELINE NEW\n");
+        return 1;
+    }
+
+    run_t base, cur;
+    if (load_run(argv[optind], &base) != 0) return 1;
+    if (load_run(argv[optind + 1], &cur) != 0) {
+        free(base.v);
+        return 1;
+    }
+
+    describe_run("Baseline", &base);
+    describe_run("New", &cur);
+
+    // what changed on the machine between the runs
+    int changed = 0;
+    for (int k = 0; k < base.fp.n; k++) {
+        if (strcmp(base.fp.key[k], "date") == 0 || strcmp(base.fp.key[k], "seed") == 0) continue;
+        const char *now = fp_get(&cur.fp, base.fp.key[k]);
+        if (now && strcmp(now, base.fp.value[k]) == 0) continue;
+        if (!changed) printf("\nFingerprint changes:\n");
+        printf("  %s: %s -> %s\n", base.fp.key[k], base.fp.value[k], now ? now : "(missing)");
+        changed = 1;
+    }
+    if (!changed) printf("\nFingerprint: same machine, kernel and settings\n");
+    const char *cpu0 = fp_get(&base.fp, "cpu"), *cpu1 = fp_get(&cur.fp, "cpu");
+    if (cpu0 && cpu1 && strcmp(cpu0, cpu1) != 0) {
+        printf("note: different CPUs, differences are not just the software stack\n");
+    }
+
+    printf("\nPoint\t\t\t\tUnit\t\tBaseline\tNew\t\tChange\tVerdict\n");
+    printf("----------------------------------------------------------------------------"
+           "------------------------\n");
+    size_t compared = 0, regressed = 0, improved = 0, missing = 0, unit_changed = 0;
+    for (size_t k = 0; k < base.n; k++) {
+        const point_t *b = &base.v[k];
+        const point_t *n = bsearch(b, cur.v, cur.n, sizeof(point_t), cmp_point);
+        if (!n) {
+            missing++;
+            continue;
+        }
+        if (strcmp(b->unit, n->unit) != 0) {
+            printf("%s\t%s%s -> %s\t\t\t\t\tunit changed\n", b->key,
+                   strlen(b->key) < 16 ? "\t\t\t" : strlen(b->key) < 24 ? "\t\t" : "\t",
+                   b->unit, n->unit);
+            unit_changed++;
+            continue;
+        }
+        compared++;
+        double change = b->median > 0 ? 100.0 * (n->median - b->median) / b->median : 0;
+        int apart = n->ci_lo > b->ci_hi || n->ci_hi < b->ci_lo;
+        const char *verdict = "same";
+        if (apart && change >= threshold) {
+            verdict = "REGRESSION";
+            regressed++;
+        } else if (apart && change <= -threshold) {
+            verdict = "improved";
+            improved++;
+        } else if (!verbose) {
+            continue;
+        }
+        printf("%s\t%s%s\t%s%.4g\t\t%.4g\t\t%+.1f%%\t%s\n", b->key,
+               strlen(b->key) < 16 ? "\t\t\t" : strlen(b->key) < 24 ? "\t\t" : "\t",
+               b->unit, strlen(b->unit) < 8 ? "\t" : "", b->median, n->median, change, verdict);
+    }
+    size_t added = 0;
+    for (size_t k = 0; k < cur.n; k++) {
+        if (!bsearch(&cur.v[k], base.v, base.n, sizeof(point_t), cmp_point)) added++;
+    }
+
+    printf("%zu points compared (threshold %.1f%%, disjoint 95%% CIs): %zu regressed, "
+           "%zu improved, %zu unchanged", compared, threshold, regressed, improved,
+           compared - regressed - improved);
+    if (missing || added) printf("; %zu only in the baseline, %zu only in the new run", missing, added);
+    if (unit_changed) printf("; %zu with a different unit", unit_changed);
+    printf("\n");
+
+    free(base.v);
+    free(cur.v);
+    return regressed ? 2 : 0;
+}
@@ -0,0 +1,131 @@
+// timer.c
+// timer backends. "clock" is CLOCK_MONOTONIC like the old probes; "tsc" is
+// lfence/rdtsc .. rdtscp/lfence, calibrated against CLOCK_MONOTONIC at
+// startup. either way we also measure the core clock with a dependent add
+// chain so results can be reported in core cycles as well as ns.
+#include <cpuid.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "memprobe.h"
+
+#define CALIBRATE_NS (20 * 1000 * 1000)  // one calibration window
+#define CALIBRATE_ROUNDS 5
+
+timer_state_t timer = { .kind = TIMER_CLOCK, .ticks_per_ns = 1.0 };
+
+uint64_t get_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// CPUID 0x80000007 EDX bit 8: the TSC ticks at a constant rate in every
+// P-state and C-state, so it can be used as a wall clock
+static int have_invariant_tsc(void) {
+    unsigned a, b, c, d;
+    if (!__get_cpuid(0x80000000, &a, &b, &c, &d) || a < 0x80000007) return 0;
+    __get_cpuid(0x80000007, &a, &b, &c, &d);
+    return (d >> 8) & 1;
+}
+
+// spin for a calibration window and compare TSC ticks with monotonic ns
+static double calibrate_tsc(void) {
+    double ratio[CALIBRATE_ROUNDS];
+    for (int r = 0; r < CALIBRATE_ROUNDS; r++) {
+        uint64_t ns0 = get_time_ns();
+        uint64_t t0 = timer_start();
+        uint64_t ns1;
+        do {
+            ns1 = get_time_ns();
+        } while (ns1 - ns0 < CALIBRATE_NS);
+        uint64_t t1 = timer_stop();
+        ratio[r] = (double)(t1 - t0) / (double)(ns1 - ns0);
+    }
+    qsort(ratio, CALIBRATE_ROUNDS, sizeof(double), cmp_double);
+    return ratio[CALIBRATE_ROUNDS / 2];
+}
+
+// smallest start/stop pair we can see, subtracted from every interval
+static uint64_t measure_overhead(void) {
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < 10000; i++) {
+        uint64_t t0 = timer_start();
+        uint64_t t1 = timer_stop();
+        if (t1 - t0 < best) best = t1 - t0;
+    }
+    return best;
+}
+
+// 16 dependent adds per iteration: one cycle each on every x86 core we
+// care about, and the loop counter runs alongside for free
+__attribute__((noinline))
+static void add_chain(uint64_t iterations) {
+    uint64_t x = 0;
+    __asm__ volatile(
+        "1:\n\t"
+        "add $1, %0\n\t" "add $1, %0\n\t" "add $1, %0\n\t" "add $1, %0\n\t"
+        "add $1, %0\n\t" "add $1, %0\n\t" "add $1, %0\n\t" "add $1, %0\n\t"
+        "add $1, %0\n\t" "add $1, %0\n\t" "add $1, %0\n\t" "add $1, %0\n\t"
+        "add $1, %0\n\t" "add $1, %0\n\t" "add $1, %0\n\t" "add $1, %0\n\t"
+        "sub $1, %1\n\t"
+        "jnz 1b\n\t"
+        : "+r"(x), "+r"(iterations)
+        :
+        : "cc");
+}
+
+static double measure_core_ghz(void) {
+    const uint64_t iterations = 2000000;
+    double ghz[CALIBRATE_ROUNDS];
+
+    add_chain(iterations); // let the clock ramp up
+    for (int r = 0; r < CALIBRATE_ROUNDS; r++) {
+        uint64_t t0 = timer_start();
+        add_chain(iterations);
+        uint64_t t1 = timer_stop();
+        ghz[r] = 16.0 * iterations / timer_elapsed_ns(t0, t1, 1);
+    }
+    qsort(ghz, CALIBRATE_ROUNDS, sizeof(double), cmp_double);
+    return ghz[CALIBRATE_ROUNDS / 2];
+}
+
+int timer_init(timer_kind_t kind) {
+    if (kind == TIMER_TSC && !have_invariant_tsc()) {
+        fprintf(stderr, "timer: no invariant TSC, falling back to clock\n");
+        kind = TIMER_CLOCK;
+    }
+
+    timer.kind = kind;
+    timer.ticks_per_ns = 1.0;
+    timer.overhead = 0;
+    if (kind == TIMER_TSC) timer.ticks_per_ns = calibrate_tsc();
+    timer.overhead = measure_overhead();
+    timer.core_ghz = measure_core_ghz();
+    return 0;
+}
+
+const char *timer_name(void) {
+    return timer.kind == TIMER_TSC ? "tsc" : "clock";
+}
+
+void timer_describe(void) {
+    printf("Timer: %s", timer_name());
+    if (timer.kind == TIMER_TSC) printf(" (%.3f GHz TSC)", timer.ticks_per_ns);
+    printf(", overhead %.1f ns, core clock %.3f GHz\n",
+           timer.overhead / timer.ticks_per_ns, timer.core_ghz);
+}
+
+// ns per operation for an interval covering ops operations,
+// with the timer's own start/stop cost taken out
+double timer_elapsed_ns(uint64_t start, uint64_t stop, uint64_t ops) {
+    uint64_t ticks = stop - start;
+    ticks = ticks > timer.overhead ? ticks - timer.overhead : 0;
+    return (double)ticks / timer.ticks_per_ns / (double)ops;
+}
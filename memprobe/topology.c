@@ -0,0 +1,166 @@
+// topology.c
+// which kind of core is which on hybrid parts. CPUID leaf 0x1A answers it
+// for the core we run on, so we hop across every online cpu and ask. when
+// that leaf isn't there (AMD, VMs that hide it) the hybrid PMU nodes
+// /sys/devices/cpu_core and cpu_atom list the cpus of each kind; failing
+// both, cpus are told apart by cache sizes from sysfs, and by max clock only
+// where it clearly splits into separate classes.
+#define _GNU_SOURCE
+#include <cpuid.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memprobe.h"
+
+static int add_cpu(core_type_t *types, int *n, const char *name, int cpu) {
+    int t;
+    for (t = 0; t < *n; t++) {
+        if (strcmp(types[t].name, name) == 0) break;
+    }
+    if (t == *n) {
+        if (*n == MAX_CORE_TYPES) return -1;
+        memset(&types[t], 0, sizeof(types[t]));
+        snprintf(types[t].name, sizeof(types[t].name), "%s", name);
+        (*n)++;
+    }
+    cpumask_set(&types[t].cpus, cpu);
+    return 0;
+}
+
+static int types_from_cpuid(const cpumask_t *online, core_type_t *types) {
+    unsigned a = 0, b = 0, c = 0, d = 0;
+    if (!__get_cpuid_count(7, 0, &a, &b, &c, &d) || !(d & (1u << 15))) return 0;
+
+    cpu_set_t saved;
+    if (sched_getaffinity(0, sizeof(saved), &saved) != 0) return 0;
+
+    int n = 0;
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        if (!cpumask_test(online, cpu) || pin_to_core(cpu) != 0) continue;
+        a = 0;
+        if (!__get_cpuid_count(0x1a, 0, &a, &b, &c, &d)) break;
+
+        char name[48];
+        switch (a >> 24) {
+        case 0x20: snprintf(name, sizeof(name), "E-core"); break;
+        case 0x40: snprintf(name, sizeof(name), "P-core"); break;
+        default:   snprintf(name, sizeof(name), "type 0x%02x", a >> 24); break;
+        }
+        if (add_cpu(types, &n, name, cpu) != 0) break;
+    }
+    sched_setaffinity(0, sizeof(saved), &saved);
+    return n;
+}
+
+static int types_from_pmu(core_type_t *types) {
+    static const char *const nodes[][2] = {
+        { "/sys/devices/cpu_core/cpus", "P-core" },
+        { "/sys/devices/cpu_atom/cpus", "E-core" },
+    };
+    int n = 0;
+    for (int i = 0; i < 2; i++) {
+        FILE *f = fopen(nodes[i][0], "r");
+        if (!f) continue;
+        char buf[4096];
+        if (fgets(buf, sizeof(buf), f) && parse_cpu_list(buf, &types[n].cpus) == 0 &&
+            cpumask_count(&types[n].cpus) > 0) {
+            snprintf(types[n].name, sizeof(types[n].name), "%s", nodes[i][1]);
+            n++;
+        }
+        fclose(f);
+    }
+    return n;
+}
+
+static long cpu_max_khz(int cpu) {
+    char path[128];
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", cpu);
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    long khz = 0;
+    if (fscanf(f, "%ld", &khz) != 1) khz = 0;
+    fclose(f);
+    return khz;
+}
+
+static int cmp_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// the clock class of mhz: the top of the run of sorted max clocks it sits in,
+// where a run breaks at a gap over FREQ_SPLIT. favored cores (ITMT, per-core
+// highest_perf) sit a few percent apart and stay in one class.
+#define FREQ_SPLIT 1.15
+static int freq_class(const int *sorted, int n, int mhz) {
+    int i = 0;
+    while (i < n && sorted[i] < mhz) i++;
+    while (i + 1 < n && sorted[i + 1] <= sorted[i] * FREQ_SPLIT) i++;
+    return i < n ? sorted[i] : mhz;
+}
+
+static int types_from_sysfs(const cpumask_t *online, core_type_t *types) {
+    static int mhz[MAX_CPUS], sorted[MAX_CPUS];
+    int ncpus = 0;
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        if (!cpumask_test(online, cpu)) continue;
+        mhz[cpu] = (int)(cpu_max_khz(cpu) / 1000);
+        sorted[ncpus++] = mhz[cpu];
+    }
+    qsort(sorted, ncpus, sizeof(int), cmp_int);
+    int split = ncpus > 0 && freq_class(sorted, ncpus, sorted[0]) != sorted[ncpus - 1];
+
+    int n = 0;
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        if (!cpumask_test(online, cpu)) continue;
+        int l1 = (int)(sysfs_cache_size(cpu, 0) / (long)KB);
+        int l2 = (int)(sysfs_cache_size(cpu, 2) / (long)KB);
+
+        char name[48];
+        if (split) {
+            snprintf(name, sizeof(name), "L1d %dK L2 %dK %dMHz", l1, l2,
+                     freq_class(sorted, ncpus, mhz[cpu]));
+        } else {
+            snprintf(name, sizeof(name), "L1d %dK L2 %dK", l1, l2);
+        }
+        if (add_cpu(types, &n, name, cpu) != 0) break;
+    }
+    return n;
+}
+
+// fills types[0..MAX_CORE_TYPES) and returns how many, 0 if the online list
+// can't be read. *source names where the answer came from.
+int core_types(core_type_t *types, const char **source) {
+    cpumask_t online;
+    if (online_cpus(&online) != 0) return 0;
+
+    int n = types_from_cpuid(&online, types);
+    if (n > 0) {
+        *source = "cpuid 0x1a";
+        return n;
+    }
+    n = types_from_pmu(types);
+    if (n > 0) {
+        *source = "sysfs pmu";
+        return n;
+    }
+    *source = "sysfs cache sizes";
+    return types_from_sysfs(&online, types);
+}
+
+int first_cpu(const cpumask_t *mask) {
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        if (cpumask_test(mask, cpu)) return cpu;
+    }
+    return -1;
+}
+
+// CPUID.1:ECX bit 31, set by every hypervisor that admits to being one
+int under_hypervisor(void) {
+    unsigned a = 0, b = 0, c = 0, d = 0;
+    __get_cpuid(1, &a, &b, &c, &d);
+    return (c >> 31) & 1;
+}